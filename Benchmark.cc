@@ -0,0 +1,601 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <chrono>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <getopt.h>
+#include <cmath>
+#include <sys/stat.h>
+#include "RecommenderSystem.h"
+#include "SyntheticMatrix.h"
+#include "SimilarityKernels.h"
+#include "BlockedPairs.h"
+#include "PairSums.h"
+#include "ParallelFor.h"
+#include "Random.h"
+
+using namespace std;
+
+// Contador de reservas en el montón: el banco de pruebas sustituye el
+// operator new global, así que cuenta también las de la biblioteca estándar
+static atomic<long long> allocationCount(0);
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    void* p = malloc(size > 0 ? size : 1);
+    if (!p) throw bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// Fases medidas en cada ejecución, en el orden del proceso completo
+enum BenchPhase {
+    PHASE_LOAD,
+    PHASE_SIMILARITY,
+    PHASE_NEIGHBORS,
+    PHASE_PREDICTION,
+    PHASE_RECOMMENDATION,
+    NUM_PHASES
+};
+
+static const char* kPhaseNames[NUM_PHASES] = {"load", "similarity", "neighbors", "prediction", "recommendation"};
+
+struct BenchResult {
+    int users;
+    int items;
+    string metric;
+    double seconds[NUM_PHASES];
+    long long allocations[NUM_PHASES];
+    double total;
+};
+
+void printUsage(const char* programName) {
+    cout << "Uso: " << programName << " [OPCIONES]" << endl;
+    cout << "\nGenerar una matriz sintética:" << endl;
+    cout << "  -g, --generate             Escribir una matriz y salir" << endl;
+    cout << "  -u, --users <número>       Usuarios (por defecto: 100)" << endl;
+    cout << "  -i, --items <número>       Ítems (por defecto: 1000)" << endl;
+    cout << "  -o, --output <archivo>     Archivo de salida (por defecto:" << endl;
+    cout << "                             utility-matrix-<u>-<i>-<semilla>-d<densidad>-r<mín>_<máx>.txt)" << endl;
+    cout << "\nBanco de pruebas (por defecto):" << endl;
+    cout << "      --sizes <lista>        Tamaños <usuarios>x<ítems> separados por comas" << endl;
+    cout << "                             (por defecto: 100x1000,500x1000,1000x1000,2000x1000)" << endl;
+    cout << "  -m, --metrics <lista>      Métricas separadas por comas (por defecto: pearson,cosine,euclidean)" << endl;
+    cout << "  -k, --neighbors <número>   Número de vecinos (por defecto: 3)" << endl;
+    cout << "  -p, --prediction <tipo>    simple o mean (por defecto: simple)" << endl;
+    cout << "  -e, --engine <motor>       pairwise o blocked (paneles de 8 usuarios en registros, sin" << endl;
+    cout << "                             teselas de ítems; por defecto: pairwise)" << endl;
+    cout << "  -t, --threads <número>     Hilos (por defecto: todos)" << endl;
+    cout << "  -r, --repeat <número>      Repeticiones; se guarda el mínimo de cada fase (por defecto: 1)" << endl;
+    cout << "      --dir <directorio>     Directorio de las matrices generadas (por defecto: bench-data)" << endl;
+    cout << "      --csv <archivo>        Guardar los resultados en CSV" << endl;
+    cout << "      --json <archivo>       Guardar los resultados en JSON" << endl;
+    cout << "\nComprobación de precisión:" << endl;
+    cout << "      --check                Comparar las similitudes de cada camino (kernels, motor por" << endl;
+    cout << "                             bloques, actualizaciones incrementales) con el cálculo en dos" << endl;
+    cout << "                             pasadas; termina con error si alguna supera la tolerancia" << endl;
+    cout << "\nComunes:" << endl;
+    cout << "  -d, --density <fracción>   Fracción de celdas con calificación (por defecto: 0.5)" << endl;
+    cout << "      --min <valor>          Calificación mínima (por defecto: 0)" << endl;
+    cout << "      --max <valor>          Calificación máxima (por defecto: 5)" << endl;
+    cout << "      --seed <número>        Semilla del generador (por defecto: 1)" << endl;
+    cout << "  -h, --help                 Mostrar esta ayuda" << endl;
+}
+
+enum LongOnlyOption {
+    OPT_SIZES = 256,
+    OPT_DIR,
+    OPT_CSV,
+    OPT_JSON,
+    OPT_MIN,
+    OPT_MAX,
+    OPT_SEED,
+    OPT_CHECK
+};
+
+static vector<string> splitList(const string& text) {
+    vector<string> parts;
+    stringstream ss(text);
+    string part;
+    while (getline(ss, part, ',')) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+// Caminos del cálculo de similitudes que se comparan con la referencia
+enum CheckPath {
+    PATH_SPARSE,
+    PATH_MASKED,
+    PATH_SCALAR,
+    PATH_KERNEL,
+    PATH_BLOCKED,
+    PATH_UPDATES,
+    NUM_PATHS
+};
+
+static const char* kPathNames[NUM_PATHS] = {"sparse", "masked", "scalar", "kernel", "blocked", "updates"};
+
+// Pearson, coseno y euclídea; Jaccard solo depende de cuentas enteras
+const int kCheckMetrics = 3;
+static const char* kCheckMetricNames[kCheckMetrics] = {"pearson", "cosine", "euclidean"};
+
+// Matrices de la comprobación: además del caso habitual, una dispersa (sin
+// vista densa), calificaciones desplazadas lejos de 0 y filas casi
+// constantes. En estas dos Pearson en una pasada pierde cifras en
+// proporción a media² / varianza (unas 1e6 veces aquí), de ahí su tolerancia
+struct CheckCase {
+    const char* name;
+    double density;
+    double minRating;
+    double maxRating;
+    double tolerance;
+};
+
+static const CheckCase kCheckCases[] = {
+    {"uniforme", 0.5, 0.0, 5.0, 1e-12},
+    {"dispersa", 0.05, 0.0, 5.0, 1e-12},
+    {"desplazada", 0.5, 1000.0, 1005.0, 1e-8},
+    {"casi constante", 0.5, 3.0, 3.01, 1e-8}
+};
+
+// Referencia: medias y luego desviaciones, en long double
+static void referenceSimilarities(const SparseRow& a, const SparseRow& b, double* out) {
+    long double meanX = 0.0L, meanY = 0.0L;
+    int count = 0;
+    for (int p = 0, q = 0; p < a.size && q < b.size; ) {
+        if (a.index[p] < b.index[q]) p++;
+        else if (a.index[p] > b.index[q]) q++;
+        else { meanX += a.value[p++]; meanY += b.value[q++]; count++; }
+    }
+    out[0] = out[1] = out[2] = 0.0;
+    if (count == 0) return;
+    meanX /= count;
+    meanY /= count;
+    long double covariance = 0.0L, varianceX = 0.0L, varianceY = 0.0L;
+    long double dot = 0.0L, normX = 0.0L, normY = 0.0L, distance = 0.0L;
+    for (int p = 0, q = 0; p < a.size && q < b.size; ) {
+        if (a.index[p] < b.index[q]) { p++; continue; }
+        if (a.index[p] > b.index[q]) { q++; continue; }
+        long double x = a.value[p++], y = b.value[q++];
+        covariance += (x - meanX) * (y - meanY);
+        varianceX += (x - meanX) * (x - meanX);
+        varianceY += (y - meanY) * (y - meanY);
+        dot += x * y;
+        normX += x * x;
+        normY += y * y;
+        distance += (x - y) * (x - y);
+    }
+    if (count >= 2 && varianceX > 0.0L && varianceY > 0.0L) {
+        out[0] = (double)(covariance / sqrtl(varianceX * varianceY));
+    }
+    if (normX > 0.0L && normY > 0.0L) out[1] = (double)(dot / sqrtl(normX * normY));
+    out[2] = (double)(1.0L / (1.0L + sqrtl(distance)));
+}
+
+static void similaritiesFromSums(const CoRatedSums& sums, double* out) {
+    out[0] = pearsonFromSums(sums);
+    out[1] = cosineFromSums(sums);
+    out[2] = euclideanFromSums(sums);
+}
+
+static size_t pairIndex(int i, int j, int n) {
+    return (size_t)i * (2 * (size_t)n - i - 1) / 2 + (size_t)(j - i - 1);
+}
+
+// Error máximo de un camino: sus sumas de cada par frente a la referencia
+// sobre la matriz actual
+static void accumulateErrors(const UtilityMatrix& matrix, const vector<CoRatedSums>& sums, double* maxError) {
+    int n = matrix.getNumUsers();
+    double fast[kCheckMetrics], exact[kCheckMetrics];
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            similaritiesFromSums(sums[pairIndex(i, j, n)], fast);
+            referenceSimilarities(matrix.getUserRow(i), matrix.getUserRow(j), exact);
+            for (int m = 0; m < kCheckMetrics; m++) {
+                maxError[m] = max(maxError[m], fabs(fast[m] - exact[m]));
+            }
+        }
+    }
+}
+
+// Errores de cada camino disponible para la matriz (NAN si no se aplica)
+static void checkCase(UtilityMatrix& matrix, uint64_t seed, int numThreads, double errors[NUM_PATHS][kCheckMetrics]) {
+    int n = matrix.getNumUsers();
+    int words = matrix.getMaskWords();
+    for (int path = 0; path < NUM_PATHS; path++) {
+        for (int m = 0; m < kCheckMetrics; m++) errors[path][m] = NAN;
+    }
+    vector<CoRatedSums> sums(n > 1 ? (size_t)n * (n - 1) / 2 : 0);
+    
+    for (int path = PATH_SPARSE; path <= PATH_KERNEL; path++) {
+        if ((path == PATH_MASKED && !matrix.hasRatedMasks()) ||
+            ((path == PATH_SCALAR || path == PATH_KERNEL) && !matrix.hasDenseView())) {
+            continue;
+        }
+        CoRatedKernel kernel = path == PATH_SCALAR ? coRatedSumsScalar : selectCoRatedKernel();
+        for (int i = 0; i < n; i++) {
+            for (int j = i + 1; j < n; j++) {
+                CoRatedSums& out = sums[pairIndex(i, j, n)];
+                if (path == PATH_SPARSE) {
+                    coRatedSumsSparse(matrix.getUserRow(i), matrix.getUserRow(j), out);
+                } else if (path == PATH_MASKED) {
+                    coRatedSumsMasked(matrix.getUserRow(i), matrix.getUserRow(j),
+                                      matrix.getRatedMask(i), matrix.getRatedMask(j), words, out);
+                } else {
+                    kernel(matrix.getDenseRow(i), matrix.getDenseRow(j),
+                           matrix.getRatedMask(i), matrix.getRatedMask(j), words, out);
+                }
+            }
+        }
+        for (int m = 0; m < kCheckMetrics; m++) errors[path][m] = 0.0;
+        accumulateErrors(matrix, sums, errors[path]);
+    }
+    
+    forEachPairBlocked(matrix, numThreads, [&](int i, int j, const CoRatedSums& pair) {
+        sums[pairIndex(i, j, n)] = pair;
+    });
+    for (int m = 0; m < kCheckMetrics; m++) errors[PATH_BLOCKED][m] = 0.0;
+    accumulateErrors(matrix, sums, errors[PATH_BLOCKED]);
+    
+    // Como applyUpdates: las sumas guardadas se corrigen en cada cambio
+    // (una de cada cuatro elimina la calificación) y al final se comparan
+    // con la referencia sobre la matriz resultante
+    PairSums pairSums;
+    pairSums.resize(n);
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            CoRatedSums pair;
+            coRatedSumsSparse(matrix.getUserRow(i), matrix.getUserRow(j), pair);
+            pairSums.set(i, j, pair);
+        }
+    }
+    uint64_t state = seed;
+    double range = matrix.getMaxRating() - matrix.getMinRating();
+    for (int update = 0; update < 50 * n; update++) {
+        int user = min(n - 1, (int)(nextUniform(state) * n));
+        int item = min(matrix.getNumItems() - 1, (int)(nextUniform(state) * matrix.getNumItems()));
+        bool hadRating = !matrix.isMissing(user, item);
+        bool hasRating = nextUniform(state) >= 0.25;
+        double oldRating = hadRating ? matrix.getRating(user, item) : 0.0;
+        double newRating = (float)(matrix.getMinRating() + range * nextUniform(state));
+        if (!hadRating && !hasRating) continue;
+        
+        SparseRow raters = matrix.getItemColumn(item);
+        for (int r = 0; r < raters.size; r++) {
+            int other = raters.index[r];
+            if (other == user) continue;
+            if (hadRating) pairSums.update(user, other, oldRating, raters.value[r], -1);
+            if (hasRating) pairSums.update(user, other, newRating, raters.value[r], +1);
+        }
+        if (hasRating) {
+            matrix.setRating(user, item, newRating);
+        } else {
+            matrix.removeRating(user, item);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++) {
+            sums[pairIndex(i, j, n)] = pairSums.get(i, j);
+        }
+    }
+    for (int m = 0; m < kCheckMetrics; m++) errors[PATH_UPDATES][m] = 0.0;
+    accumulateErrors(matrix, sums, errors[PATH_UPDATES]);
+}
+
+// Tabla de errores máximos por caso y camino; falso si alguno supera la tolerancia
+static bool runPrecisionCheck(SyntheticSpec spec, const string& dataDir, int numThreads) {
+    spec.users = 64;
+    spec.items = 256;
+    cout << "Comprobación de precisión frente a dos pasadas en long double (" << spec.users << " x "
+         << spec.items << ", kernel " << coRatedKernelName() << ")" << endl;
+    cout << left << setw(16) << "caso" << setw(9) << "camino" << right;
+    for (int m = 0; m < kCheckMetrics; m++) cout << setw(12) << kCheckMetricNames[m];
+    cout << setw(12) << "tolerancia" << endl;
+    
+    bool passed = true;
+    for (const CheckCase& check : kCheckCases) {
+        spec.density = check.density;
+        spec.minRating = check.minRating;
+        spec.maxRating = check.maxRating;
+        string filename = dataDir + "/" + syntheticFileName(spec);
+        UtilityMatrix matrix;
+        if (!writeSyntheticMatrix(spec, filename) || !matrix.loadFromFile(filename, numThreads)) {
+            return false;
+        }
+        
+        double errors[NUM_PATHS][kCheckMetrics];
+        checkCase(matrix, spec.seed, numThreads, errors);
+        for (int path = 0; path < NUM_PATHS; path++) {
+            cout << left << setw(16) << check.name << setw(9) << kPathNames[path] << right;
+            for (int m = 0; m < kCheckMetrics; m++) {
+                if (std::isnan(errors[path][m])) {
+                    cout << setw(12) << "-";
+                } else {
+                    cout << setw(12) << scientific << setprecision(1) << errors[path][m];
+                    passed = passed && errors[path][m] < check.tolerance;
+                }
+            }
+            cout << setw(12) << scientific << setprecision(0) << check.tolerance << endl;
+        }
+    }
+    cout << (passed ? "Todas las diferencias están por debajo de la tolerancia"
+                    : "Error: alguna diferencia supera la tolerancia") << endl;
+    return passed;
+}
+
+// Tiempo y reservas de la fase que termina; deja las marcas al principio de la siguiente
+static void endPhase(chrono::steady_clock::time_point& start, long long& mark, double& seconds, long long& allocations) {
+    chrono::steady_clock::time_point now = chrono::steady_clock::now();
+    long long count = allocationCount.load(memory_order_relaxed);
+    seconds = chrono::duration<double>(now - start).count();
+    allocations = count - mark;
+    start = now;
+    mark = count;
+}
+
+// Proceso completo por fases, sin imprimir la matriz ni escribir informes
+static void runOnce(const string& filename, const RecommenderOptions& options, double* seconds, long long* allocations) {
+    chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+    long long mark = allocationCount.load(memory_order_relaxed);
+    RecommenderSystem system(filename, options);
+    endPhase(clock, mark, seconds[PHASE_LOAD], allocations[PHASE_LOAD]);
+    system.computeSimilarities();
+    endPhase(clock, mark, seconds[PHASE_SIMILARITY], allocations[PHASE_SIMILARITY]);
+    system.buildNeighborIndex();
+    endPhase(clock, mark, seconds[PHASE_NEIGHBORS], allocations[PHASE_NEIGHBORS]);
+    system.predictAll();
+    endPhase(clock, mark, seconds[PHASE_PREDICTION], allocations[PHASE_PREDICTION]);
+    system.generateRecommendations();
+    endPhase(clock, mark, seconds[PHASE_RECOMMENDATION], allocations[PHASE_RECOMMENDATION]);
+}
+
+static bool writeCsv(const string& filename, const vector<BenchResult>& results, const SyntheticSpec& spec,
+                     const RecommenderOptions& options) {
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: No se puede crear el archivo " << filename << endl;
+        return false;
+    }
+    file << "users,items,density,metric,prediction,neighbors,engine,kernel,threads";
+    for (int phase = 0; phase < NUM_PHASES; phase++) file << "," << kPhaseNames[phase] << "_s";
+    file << ",total_s";
+    for (int phase = 0; phase < NUM_PHASES; phase++) file << "," << kPhaseNames[phase] << "_allocs";
+    file << "\n";
+    file << fixed << setprecision(6);
+    for (const BenchResult& result : results) {
+        file << result.users << "," << result.items << "," << spec.density << "," << result.metric << ","
+             << predictionKey(options.predictionType) << "," << options.numNeighbors << ","
+             << (options.engine == ENGINE_BLOCKED ? "blocked" : "pairwise") << "," << coRatedKernelName() << ","
+             << resolveThreadCount(options.numThreads);
+        for (int phase = 0; phase < NUM_PHASES; phase++) file << "," << result.seconds[phase];
+        file << "," << result.total;
+        for (int phase = 0; phase < NUM_PHASES; phase++) file << "," << result.allocations[phase];
+        file << "\n";
+    }
+    return (bool)file;
+}
+
+static bool writeJson(const string& filename, const vector<BenchResult>& results, const SyntheticSpec& spec,
+                      const RecommenderOptions& options, int repeat) {
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: No se puede crear el archivo " << filename << endl;
+        return false;
+    }
+    file << fixed << setprecision(6);
+    file << "{\n";
+    file << "  \"config\": {\"density\": " << spec.density << ", \"min_rating\": " << spec.minRating
+         << ", \"max_rating\": " << spec.maxRating << ", \"seed\": " << spec.seed
+         << ", \"prediction\": \"" << predictionKey(options.predictionType)
+         << "\", \"neighbors\": " << options.numNeighbors
+         << ", \"engine\": \"" << (options.engine == ENGINE_BLOCKED ? "blocked" : "pairwise")
+         << "\", \"kernel\": \"" << coRatedKernelName() << "\", \"threads\": " << resolveThreadCount(options.numThreads)
+         << ", \"repeat\": " << repeat << "},\n";
+    file << "  \"results\": [\n";
+    for (size_t r = 0; r < results.size(); r++) {
+        const BenchResult& result = results[r];
+        file << "    {\"users\": " << result.users << ", \"items\": " << result.items
+             << ", \"metric\": \"" << result.metric << "\", \"seconds\": {";
+        for (int phase = 0; phase < NUM_PHASES; phase++) {
+            file << "\"" << kPhaseNames[phase] << "\": " << result.seconds[phase] << ", ";
+        }
+        file << "\"total\": " << result.total << "}, \"allocations\": {";
+        for (int phase = 0; phase < NUM_PHASES; phase++) {
+            file << "\"" << kPhaseNames[phase] << "\": " << result.allocations[phase] << (phase + 1 < NUM_PHASES ? ", " : "");
+        }
+        file << "}}" << (r + 1 < results.size() ? "," : "") << "\n";
+    }
+    file << "  ]\n}\n";
+    return (bool)file;
+}
+
+int main(int argc, char *argv[]) {
+    SyntheticSpec spec;
+    RecommenderOptions options;
+    options.reportFormat = REPORT_NONE;
+    bool generate = false;
+    string output;
+    string sizesText = "100x1000,500x1000,1000x1000,2000x1000";
+    string metricsText = "pearson,cosine,euclidean";
+    string dataDir = "bench-data";
+    string csvFile, jsonFile;
+    int repeat = 1;
+    bool check = false;
+
+    static struct option long_options[] = {
+        {"generate",   no_argument,       0, 'g'},
+        {"users",      required_argument, 0, 'u'},
+        {"items",      required_argument, 0, 'i'},
+        {"density",    required_argument, 0, 'd'},
+        {"output",     required_argument, 0, 'o'},
+        {"metrics",    required_argument, 0, 'm'},
+        {"neighbors",  required_argument, 0, 'k'},
+        {"prediction", required_argument, 0, 'p'},
+        {"engine",     required_argument, 0, 'e'},
+        {"threads",    required_argument, 0, 't'},
+        {"repeat",     required_argument, 0, 'r'},
+        {"sizes",      required_argument, 0, OPT_SIZES},
+        {"dir",        required_argument, 0, OPT_DIR},
+        {"csv",        required_argument, 0, OPT_CSV},
+        {"json",       required_argument, 0, OPT_JSON},
+        {"min",        required_argument, 0, OPT_MIN},
+        {"max",        required_argument, 0, OPT_MAX},
+        {"seed",       required_argument, 0, OPT_SEED},
+        {"check",      no_argument,       0, OPT_CHECK},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    int option_index = 0;
+    while ((opt = getopt_long(argc, argv, "gu:i:d:o:m:k:p:e:t:r:h", long_options, &option_index)) != -1) {
+        switch (opt) {
+            case 'g': generate = true; break;
+            case 'u': spec.users = atoi(optarg); break;
+            case 'i': spec.items = atoi(optarg); break;
+            case 'd': spec.density = atof(optarg); break;
+            case 'o': output = optarg; break;
+            case 'm': metricsText = optarg; break;
+            case 'k': options.numNeighbors = atoi(optarg); break;
+            case 'p':
+                if (!parsePrediction(optarg, options.predictionType)) return 1;
+                break;
+            case 'e':
+                if (string(optarg) == "pairwise") {
+                    options.engine = ENGINE_PAIRWISE;
+                } else if (string(optarg) == "blocked") {
+                    options.engine = ENGINE_BLOCKED;
+                } else {
+                    cerr << "Error: Motor no válido. Use: pairwise o blocked" << endl;
+                    return 1;
+                }
+                break;
+            case 't': options.numThreads = atoi(optarg); break;
+            case 'r': repeat = atoi(optarg); break;
+            case OPT_SIZES: sizesText = optarg; break;
+            case OPT_DIR: dataDir = optarg; break;
+            case OPT_CSV: csvFile = optarg; break;
+            case OPT_JSON: jsonFile = optarg; break;
+            case OPT_MIN: spec.minRating = atof(optarg); break;
+            case OPT_MAX: spec.maxRating = atof(optarg); break;
+            case OPT_SEED: spec.seed = strtoull(optarg, NULL, 10); break;
+            case OPT_CHECK: check = true; break;
+            case 'h':
+                printUsage(argv[0]);
+                return 0;
+            default:
+                printUsage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (spec.density < 0.0 || spec.density > 1.0 || spec.minRating >= spec.maxRating ||
+        options.numNeighbors <= 0 || options.numThreads < 0 || repeat <= 0) {
+        cerr << "Error: Parámetros no válidos (densidad en [0, 1], mínimo < máximo, k, hilos y repeticiones positivos)" << endl;
+        return 1;
+    }
+
+    // Solo generar
+    if (generate) {
+        if (spec.users <= 0 || spec.items <= 0) {
+            cerr << "Error: El número de usuarios e ítems debe ser mayor que 0" << endl;
+            return 1;
+        }
+        if (output.empty()) output = syntheticFileName(spec);
+        if (!writeSyntheticMatrix(spec, output)) return 1;
+        cout << "Matriz de " << spec.users << " x " << spec.items << " guardada en " << output << endl;
+        return 0;
+    }
+
+    if (check) {
+        mkdir(dataDir.c_str(), 0755);
+        return runPrecisionCheck(spec, dataDir, options.numThreads) ? 0 : 1;
+    }
+
+    // Rejilla de tamaños y métricas
+    vector<pair<int, int>> sizes;
+    for (const string& size : splitList(sizesText)) {
+        int users = 0, items = 0;
+        char separator = 0;
+        stringstream ss(size);
+        if (!(ss >> users >> separator >> items) || separator != 'x' || users <= 0 || items <= 0) {
+            cerr << "Error: Tamaño no válido '" << size << "'. Use <usuarios>x<ítems>" << endl;
+            return 1;
+        }
+        sizes.push_back({users, items});
+    }
+    vector<string> metrics = splitList(metricsText);
+    for (const string& name : metrics) {
+        Metric metric;
+        if (!parseMetric(name, metric)) return 1;
+    }
+    mkdir(dataDir.c_str(), 0755);
+
+    cout << "Banco de pruebas: densidad " << spec.density << ", k = " << options.numNeighbors << ", "
+         << resolveThreadCount(options.numThreads) << " hilos, kernel " << coRatedKernelName() << endl;
+    cout << setw(6) << "users" << setw(7) << "items" << setw(11) << "metric";
+    for (int phase = 0; phase < NUM_PHASES; phase++) cout << setw(16) << kPhaseNames[phase];
+    cout << setw(12) << "total" << "  reservas por fase" << endl;
+
+    vector<BenchResult> results;
+    for (const pair<int, int>& size : sizes) {
+        spec.users = size.first;
+        spec.items = size.second;
+        string filename = dataDir + "/" + syntheticFileName(spec);
+        if (!writeSyntheticMatrix(spec, filename)) return 1;
+
+        for (const string& name : metrics) {
+            if (!parseMetric(name, options.metric)) return 1;
+            BenchResult result;
+            result.users = spec.users;
+            result.items = spec.items;
+            result.metric = name;
+            double seconds[NUM_PHASES];
+            long long allocations[NUM_PHASES];
+            try {
+                for (int r = 0; r < repeat; r++) {
+                    runOnce(filename, options, seconds, allocations);
+                    for (int phase = 0; phase < NUM_PHASES; phase++) {
+                        result.seconds[phase] = r == 0 ? seconds[phase] : min(result.seconds[phase], seconds[phase]);
+                        result.allocations[phase] = r == 0 ? allocations[phase] : min(result.allocations[phase], allocations[phase]);
+                    }
+                }
+            } catch (const exception& e) {
+                cerr << "Error: " << e.what() << endl;
+                return 1;
+            }
+            result.total = 0.0;
+            for (int phase = 0; phase < NUM_PHASES; phase++) result.total += result.seconds[phase];
+            results.push_back(result);
+
+            cout << setw(6) << result.users << setw(7) << result.items << setw(11) << name << fixed << setprecision(4);
+            for (int phase = 0; phase < NUM_PHASES; phase++) cout << setw(16) << result.seconds[phase];
+            cout << setw(12) << result.total << "  ";
+            for (int phase = 0; phase < NUM_PHASES; phase++) {
+                cout << result.allocations[phase] << (phase + 1 < NUM_PHASES ? "/" : "");
+            }
+            cout << endl;
+        }
+    }
+
+    if (!csvFile.empty()) {
+        if (!writeCsv(csvFile, results, spec, options)) return 1;
+        cout << "Resultados guardados en " << csvFile << endl;
+    }
+    if (!jsonFile.empty()) {
+        if (!writeJson(jsonFile, results, spec, options, repeat)) return 1;
+        cout << "Resultados guardados en " << jsonFile << endl;
+    }
+    return 0;
+}
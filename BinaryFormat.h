@@ -0,0 +1,57 @@
+#ifndef BINARY_FORMAT_H
+#define BINARY_FORMAT_H
+
+#include <string>
+#include <cstddef>
+#include <stdint.h>
+
+using namespace std;
+
+// Formato binario: cabecera con dimensiones y posición de cada sección,
+// seguida de los arrays tal como están en memoria (alineados a 64 bytes)
+static const char kBinaryMagic[8] = {'U', 'M', 'T', 'X', 'B', 'I', 'N', '\0'};
+static const uint32_t kBinaryVersion = 1;
+static const uint32_t kByteOrderMark = 0x01020304;
+static const uint32_t kHasDenseView = 1;
+static const uint32_t kHasUserStats = 2;
+// Máscaras de calificaciones por usuario sin la vista densa (kHasDenseView
+// incluye también las máscaras)
+static const uint32_t kHasRatedMask = 4;
+
+enum BinarySection {
+    SEC_ROW_START,
+    SEC_ROW_ITEMS,
+    SEC_ROW_VALUES,
+    SEC_COL_START,
+    SEC_COL_USERS,
+    SEC_COL_VALUES,
+    SEC_DENSE_VALUES,
+    SEC_RATED_MASK,
+    SEC_USER_STATS,
+    NUM_SECTIONS
+};
+
+struct BinaryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t flags;
+    int32_t numUsers;
+    int32_t numItems;
+    int32_t maskWords;
+    int64_t numRatings;
+    double minRating;
+    double maxRating;
+    uint64_t sectionOffset[NUM_SECTIONS];
+    uint64_t sectionSize[NUM_SECTIONS];
+};
+
+// Comprueba la firma "UMTXBIN" al inicio de un archivo
+bool isBinaryMatrix(const char* data, size_t size);
+// Comprueba versión, dimensiones y que cada sección quepa en el archivo
+bool validateBinaryHeader(const BinaryHeader& header, uint64_t fileSize, const string& filename);
+// Comprueba los desplazamientos CSR o CSC leídos del archivo: count + 1
+// valores que empiezan en 0, no decrecen y terminan en total
+bool validateOffsets(const int64_t* start, int count, int64_t total, const string& filename);
+
+#endif
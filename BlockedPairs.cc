@@ -0,0 +1,185 @@
+#include "BlockedPairs.h"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define BLOCKED_PAIRS_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+void BlockPanel::pack(const UtilityMatrix& matrix, int first, int count) {
+    SparseRow rows[kBlockLanes];
+    for (int lane = 0; lane < count; lane++) {
+        rows[lane] = matrix.getUserRow(first + lane);
+    }
+    pack(rows, first, count, matrix.getNumItems());
+}
+
+void BlockPanel::pack(const SparseRow* rows, int first, int count, int numItems) {
+    this->first = first;
+    this->count = count;
+    values.assign((size_t)numItems * kBlockLanes, 0.0f);
+    masks.assign(numItems, 0);
+    for (int lane = 0; lane < count; lane++) {
+        const SparseRow& row = rows[lane];
+        for (int r = 0; r < row.size; r++) {
+            values[(size_t)row.index[r] * kBlockLanes + lane] = row.value[r];
+            masks[row.index[r]] |= (uint8_t)(1 << lane);
+        }
+    }
+}
+
+// Pasa los acumuladores por carril (uno por usuario del panel) a out
+static void storeLanes(const double* sx, const double* sy, const double* sxx, const double* syy,
+                       const double* sxy, const double* sdd, const int* count, CoRatedSums* out) {
+    for (int lane = 0; lane < kBlockLanes; lane++) {
+        out[lane].count = count[lane];
+        out[lane].sumX = sx[lane];
+        out[lane].sumY = sy[lane];
+        out[lane].sumXX = sxx[lane];
+        out[lane].sumYY = syy[lane];
+        out[lane].sumXY = sxy[lane];
+        out[lane].sumDiff2 = sdd[lane];
+    }
+}
+
+static void blockSumsScalar(const SparseRow& row, const BlockPanel& panel, CoRatedSums* out) {
+    // Acumuladores por carril en arrays contiguos y sin saltos por carril,
+    // para que el compilador pueda vectorizar el bucle interno
+    double sx[kBlockLanes] = {0}, sy[kBlockLanes] = {0}, sxx[kBlockLanes] = {0};
+    double syy[kBlockLanes] = {0}, sxy[kBlockLanes] = {0}, sdd[kBlockLanes] = {0};
+    int count[kBlockLanes] = {0};
+    for (int r = 0; r < row.size; r++) {
+        int item = row.index[r];
+        int mask = panel.masks[item];
+        if (!mask) continue;
+        double x = row.value[r];
+        const float* y = &panel.values[(size_t)item * kBlockLanes];
+        for (int lane = 0; lane < kBlockLanes; lane++) {
+            int present = (mask >> lane) & 1;
+            double m = present;
+            double v = y[lane];
+            double diff = (x - v) * m;
+            sx[lane] += x * m;
+            sy[lane] += v;
+            sxx[lane] += x * x * m;
+            syy[lane] += v * v;
+            sxy[lane] += x * v;
+            sdd[lane] += diff * diff;
+            count[lane] += present;
+        }
+    }
+    storeLanes(sx, sy, sxx, syy, sxy, sdd, count, out);
+}
+
+#ifdef BLOCKED_PAIRS_X86
+
+__attribute__((target("avx2,fma")))
+static void blockSumsAvx2(const SparseRow& row, const BlockPanel& panel, CoRatedSums* out) {
+    const __m256i lanes = _mm256_setr_epi64x(1, 2, 4, 8);
+    const __m256i lanesHigh = _mm256_setr_epi64x(16, 32, 64, 128);
+    __m256d sx[2], sy[2], sxx[2], syy[2], sxy[2], sdd[2];
+    __m256i count[2];
+    for (int h = 0; h < 2; h++) {
+        sx[h] = sy[h] = sxx[h] = syy[h] = sxy[h] = sdd[h] = _mm256_setzero_pd();
+        count[h] = _mm256_setzero_si256();
+    }
+    
+    for (int r = 0; r < row.size; r++) {
+        int item = row.index[r];
+        int bits = panel.masks[item];
+        if (!bits) continue;
+        double value = row.value[r];
+        __m256d x = _mm256_set1_pd(value);
+        __m256d xx = _mm256_set1_pd(value * value);
+        __m256i b = _mm256_set1_epi64x(bits);
+        const float* y = &panel.values[(size_t)item * kBlockLanes];
+        for (int h = 0; h < 2; h++) {
+            // Máscara por carril: los huecos del panel tienen y = 0 y no suman
+            // en los términos con y; los términos solo con x se enmascaran
+            __m256i m = _mm256_cmpeq_epi64(_mm256_and_si256(b, h ? lanesHigh : lanes), h ? lanesHigh : lanes);
+            __m256d mask = _mm256_castsi256_pd(m);
+            __m256d v = _mm256_cvtps_pd(_mm_loadu_ps(y + 4 * h));
+            __m256d d = _mm256_and_pd(_mm256_sub_pd(x, v), mask);
+            sx[h] = _mm256_add_pd(sx[h], _mm256_and_pd(x, mask));
+            sy[h] = _mm256_add_pd(sy[h], v);
+            sxx[h] = _mm256_add_pd(sxx[h], _mm256_and_pd(xx, mask));
+            syy[h] = _mm256_fmadd_pd(v, v, syy[h]);
+            sxy[h] = _mm256_fmadd_pd(x, v, sxy[h]);
+            sdd[h] = _mm256_fmadd_pd(d, d, sdd[h]);
+            count[h] = _mm256_sub_epi64(count[h], m);
+        }
+    }
+    
+    double ax[8], ay[8], axx[8], ayy[8], axy[8], add[8];
+    int64_t acount[8];
+    for (int h = 0; h < 2; h++) {
+        _mm256_storeu_pd(ax + 4 * h, sx[h]);
+        _mm256_storeu_pd(ay + 4 * h, sy[h]);
+        _mm256_storeu_pd(axx + 4 * h, sxx[h]);
+        _mm256_storeu_pd(ayy + 4 * h, syy[h]);
+        _mm256_storeu_pd(axy + 4 * h, sxy[h]);
+        _mm256_storeu_pd(add + 4 * h, sdd[h]);
+        _mm256_storeu_si256((__m256i*)(acount + 4 * h), count[h]);
+    }
+    int counts[8];
+    for (int lane = 0; lane < kBlockLanes; lane++) {
+        counts[lane] = (int)acount[lane];
+    }
+    storeLanes(ax, ay, axx, ayy, axy, add, counts, out);
+}
+
+__attribute__((target("avx512f")))
+static void blockSumsAvx512(const SparseRow& row, const BlockPanel& panel, CoRatedSums* out) {
+    __m512d sx = _mm512_setzero_pd(), sy = _mm512_setzero_pd();
+    __m512d sxx = _mm512_setzero_pd(), syy = _mm512_setzero_pd();
+    __m512d sxy = _mm512_setzero_pd(), sdd = _mm512_setzero_pd();
+    __m512i count = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi64(1);
+    
+    for (int r = 0; r < row.size; r++) {
+        int item = row.index[r];
+        __mmask8 k = panel.masks[item];
+        if (!k) continue;
+        double value = row.value[r];
+        __m512d x = _mm512_set1_pd(value);
+        __m512d xx = _mm512_set1_pd(value * value);
+        // Los huecos del panel tienen y = 0: los términos con y no necesitan máscara
+        __m512d v = _mm512_maskz_cvtps_pd(0xff, _mm256_loadu_ps(&panel.values[(size_t)item * kBlockLanes]));
+        __m512d d = _mm512_sub_pd(x, v);
+        sx = _mm512_mask_add_pd(sx, k, sx, x);
+        sy = _mm512_add_pd(sy, v);
+        sxx = _mm512_mask_add_pd(sxx, k, sxx, xx);
+        syy = _mm512_fmadd_pd(v, v, syy);
+        sxy = _mm512_fmadd_pd(x, v, sxy);
+        sdd = _mm512_mask3_fmadd_pd(d, d, sdd, k);
+        count = _mm512_mask_add_epi64(count, k, count, one);
+    }
+    
+    double ax[8], ay[8], axx[8], ayy[8], axy[8], add[8];
+    int64_t acount[8];
+    _mm512_storeu_pd(ax, sx);
+    _mm512_storeu_pd(ay, sy);
+    _mm512_storeu_pd(axx, sxx);
+    _mm512_storeu_pd(ayy, syy);
+    _mm512_storeu_pd(axy, sxy);
+    _mm512_storeu_pd(add, sdd);
+    _mm512_storeu_si512(acount, count);
+    int counts[8];
+    for (int lane = 0; lane < kBlockLanes; lane++) {
+        counts[lane] = (int)acount[lane];
+    }
+    storeLanes(ax, ay, axx, ayy, axy, add, counts, out);
+}
+
+#endif
+
+BlockKernel selectBlockKernel() {
+#ifdef BLOCKED_PAIRS_X86
+    const char* name = coRatedKernelName();
+    if (strcmp(name, "avx512") == 0) return blockSumsAvx512;
+    if (strcmp(name, "avx2") == 0) return blockSumsAvx2;
+#endif
+    return blockSumsScalar;
+}
@@ -0,0 +1,84 @@
+#ifndef BLOCKED_PAIRS_H
+#define BLOCKED_PAIRS_H
+
+#include "UtilityMatrix.h"
+#include "SimilarityKernels.h"
+#include "ParallelFor.h"
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// Usuarios por panel del motor por bloques (un registro de 8 doubles)
+const int kBlockLanes = 8;
+
+// Bloque de hasta 8 usuarios empaquetado por ítem: sus 8 calificaciones
+// contiguas (0 si falta) y una máscara de 8 bits de calificaciones presentes
+struct BlockPanel {
+    int first;
+    int count;
+    vector<float> values;
+    vector<uint8_t> masks;
+    
+    void pack(const UtilityMatrix& matrix, int first, int count);
+    // Empaqueta rows[0..count) (usuarios first..first+count) sobre numItems ítems
+    void pack(const SparseRow* rows, int first, int count, int numItems);
+};
+
+// Sumas co-calificadas de una fila frente a los usuarios del panel, en
+// out[0..7]. Como un GEMM enmascarado sobre las calificaciones X y la matriz
+// indicadora M: cada ítem de la fila se difunde y se combina con los 8
+// usuarios a la vez, y solo se visitan los ítems que la fila calificó
+typedef void (*BlockKernel)(const SparseRow& row, const BlockPanel& panel, CoRatedSums* out);
+
+// Misma elección que selectCoRatedKernel (AVX-512, AVX2 o escalar)
+BlockKernel selectBlockKernel();
+
+// Calcula las sumas de los pares i < j con i en [rowBegin, rowEnd) por
+// paneles de kBlockLanes usuarios: cada panel se empaqueta una vez y se cruza
+// con todas las filas anteriores del rango, así que cada fila se lee n/8 veces
+// en lugar de n. Es bloqueo en registros, no en caché: el panel abarca todos
+// los ítems (33 bytes por ítem) y no se divide en teselas de ítems, así que
+// solo queda en L2 mientras el catálogo es pequeño. Llama a visit(i, j, sums) una vez por par, desde varios hilos.
+// Si coRated no es nulo, recibe el total de ítems co-calificados de los pares,
+// acumulado por hilo y sumado una sola vez al final
+template <typename Visit>
+void forEachPairBlocked(const UtilityMatrix& matrix, int rowBegin, int rowEnd, int numThreads, Visit visit,
+                        long long* coRated = nullptr) {
+    int n = matrix.getNumUsers();
+    int firstPanel = (rowBegin + 1) / kBlockLanes;
+    int panels = (n + kBlockLanes - 1) / kBlockLanes - firstPanel;
+    int threads = resolveThreadCount(numThreads);
+    BlockKernel kernel = selectBlockKernel();
+    vector<BlockPanel> scratch(threads);
+    vector<long long> coRatedByThread(threads, 0);
+    
+    // Los últimos paneles se cruzan con más filas: se reparten primero
+    parallelFor(0, panels, threads, 1, [&](int p, int thread) {
+        BlockPanel& panel = scratch[thread];
+        int first = (firstPanel + panels - 1 - p) * kBlockLanes;
+        panel.pack(matrix, first, min(kBlockLanes, n - first));
+        
+        CoRatedSums sums[kBlockLanes];
+        long long items = 0;
+        for (int i = rowBegin; i < min(rowEnd, first + panel.count - 1); i++) {
+            kernel(matrix.getUserRow(i), panel, sums);
+            for (int lane = max(0, i + 1 - first); lane < panel.count; lane++) {
+                items += sums[lane].count;
+                visit(i, first + lane, sums[lane]);
+            }
+        }
+        coRatedByThread[thread] += items;
+    });
+    if (coRated) {
+        for (long long items : coRatedByThread) *coRated += items;
+    }
+}
+
+// Todos los pares i < j de la matriz
+template <typename Visit>
+void forEachPairBlocked(const UtilityMatrix& matrix, int numThreads, Visit visit, long long* coRated = nullptr) {
+    forEachPairBlocked(matrix, 0, matrix.getNumUsers(), numThreads, visit, coRated);
+}
+
+#endif
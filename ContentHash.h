@@ -0,0 +1,26 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstring>
+#include <stdint.h>
+
+// Hash de 64 bits para detectar cambios de contenido (no criptográfico).
+// Procesa palabras de 8 bytes; se puede encadenar pasando el hash anterior
+inline uint64_t hashBytes(const void* data, size_t length, uint64_t hash = 1469598103934665603ULL) {
+    const uint64_t prime = 1099511628211ULL;
+    const unsigned char* bytes = (const unsigned char*)data;
+    size_t words = length / 8;
+    for (size_t w = 0; w < words; w++) {
+        uint64_t word;
+        memcpy(&word, bytes + w * 8, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (size_t b = words * 8; b < length; b++) {
+        hash = (hash ^ bytes[b]) * prime;
+    }
+    return hash;
+}
+
+#endif
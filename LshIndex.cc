@@ -0,0 +1,144 @@
+#include "LshIndex.h"
+#include "ContentHash.h"
+#include "ParallelFor.h"
+#include "Random.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// Normal estándar por Box-Muller
+static double nextGaussian(uint64_t& state) {
+    double u1 = nextUniform(state);
+    double u2 = nextUniform(state);
+    return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+LshIndex::LshIndex(int numTables, int numBits, uint64_t seed)
+    : numTables(numTables), numBits(numBits), seed(seed), numUsers(0) {}
+
+void LshIndex::build(const UtilityMatrix& matrix, Metric metric, int numThreads) {
+    numUsers = matrix.getNumUsers();
+    int numItems = matrix.getNumItems();
+    int hashes = numTables * numBits;
+    
+    // Proyecciones por ítem contiguas: cada calificación recorre una sola fila
+    uint64_t state = seed;
+    vector<float> projections((size_t)numItems * hashes);
+    for (size_t k = 0; k < projections.size(); k++) {
+        projections[k] = (float)nextGaussian(state);
+    }
+    
+    // Euclídea: ancho de cubeta proporcional a la norma típica de las filas
+    // y desplazamiento aleatorio en [0, ancho) por proyección
+    double width = 1.0;
+    vector<double> offsets(hashes, 0.0);
+    if (metric == EUCLIDEAN) {
+        double sumSquares = 0.0;
+        for (int u = 0; u < numUsers; u++) {
+            sumSquares += matrix.getUserStats(u).sumSquares;
+        }
+        width = numUsers > 0 ? max(1e-9, 2.0 * sqrt(sumSquares / numUsers)) : 1.0;
+        for (int h = 0; h < hashes; h++) {
+            offsets[h] = nextUniform(state) * width;
+        }
+    }
+    
+    keys.assign((size_t)numUsers * numTables, 0);
+    int threads = resolveThreadCount(numThreads);
+    vector<vector<double>> scratch(threads, vector<double>(hashes));
+    parallelFor(0, numUsers, threads, 64, [&](int user, int thread) {
+        vector<double>& dot = scratch[thread];
+        fill(dot.begin(), dot.end(), 0.0);
+        SparseRow row = matrix.getUserRow(user);
+        double center = metric == PEARSON ? matrix.getUserMean(user) : 0.0;
+        for (int r = 0; r < row.size; r++) {
+            // Jaccard solo mira qué items se calificaron: se proyecta la fila binaria
+            double x = metric == JACCARD ? 1.0 : row.value[r] - center;
+            const float* p = projections.data() + (size_t)row.index[r] * hashes;
+            for (int h = 0; h < hashes; h++) {
+                dot[h] += x * p[h];
+            }
+        }
+        
+        for (int t = 0; t < numTables; t++) {
+            uint64_t key = 0;
+            if (metric == EUCLIDEAN) {
+                int64_t cells[64];
+                for (int b = 0; b < numBits; b++) {
+                    int h = t * numBits + b;
+                    cells[b] = (int64_t)floor((dot[h] + offsets[h]) / width);
+                }
+                key = hashBytes(cells, numBits * sizeof(int64_t));
+            } else {
+                for (int b = 0; b < numBits; b++) {
+                    if (dot[t * numBits + b] > 0.0) key |= (uint64_t)1 << b;
+                }
+            }
+            keys[(size_t)user * numTables + t] = key;
+        }
+    });
+    
+    // Ordenar cada tabla por clave; a igualdad, por un hash del usuario para
+    // que la ventana no favorezca siempre a los ids bajos
+    order.resize((size_t)numTables * numUsers);
+    position.resize((size_t)numTables * numUsers);
+    parallelFor(0, numTables, threads, 1, [&](int t, int) {
+        int* first = order.data() + (size_t)t * numUsers;
+        vector<uint64_t> tieBreak(numUsers);
+        for (int u = 0; u < numUsers; u++) {
+            first[u] = u;
+            uint64_t mix = seed + t * 0x9E3779B97F4A7C15ULL + u;
+            tieBreak[u] = nextRandom(mix);
+        }
+        sort(first, first + numUsers, [&](int a, int b) {
+            uint64_t ka = keys[(size_t)a * numTables + t], kb = keys[(size_t)b * numTables + t];
+            if (ka != kb) return ka < kb;
+            return tieBreak[a] < tieBreak[b];
+        });
+        for (int p = 0; p < numUsers; p++) {
+            position[(size_t)t * numUsers + first[p]] = p;
+        }
+    });
+}
+
+void LshIndex::getCandidates(int user, int window, int limit, vector<int>& candidates,
+                             vector<pair<int, int>>& votes) const {
+    candidates.clear();
+    for (int t = 0; t < numTables; t++) {
+        const int* users = order.data() + (size_t)t * numUsers;
+        uint64_t key = keys[(size_t)user * numTables + t];
+        int p = position[(size_t)t * numUsers + user];
+        for (int q = p - 1; q >= 0 && q >= p - window; q--) {
+            if (keys[(size_t)users[q] * numTables + t] != key) break;
+            candidates.push_back(users[q]);
+        }
+        for (int q = p + 1; q < numUsers && q <= p + window; q++) {
+            if (keys[(size_t)users[q] * numTables + t] != key) break;
+            candidates.push_back(users[q]);
+        }
+    }
+    sort(candidates.begin(), candidates.end());
+    
+    // Compactar contando en cuántas tablas coincide cada candidato
+    size_t distinct = 0;
+    votes.clear();
+    for (size_t k = 0; k < candidates.size(); ) {
+        size_t next = k;
+        while (next < candidates.size() && candidates[next] == candidates[k]) next++;
+        votes.push_back({(int)(next - k), candidates[k]});
+        candidates[distinct++] = candidates[k];
+        k = next;
+    }
+    candidates.resize(distinct);
+    if ((int)distinct <= limit) return;
+    
+    // Más coincidencias primero; a igualdad, el id menor
+    nth_element(votes.begin(), votes.begin() + limit, votes.end(), [](const pair<int, int>& a, const pair<int, int>& b) {
+        return a.first != b.first ? a.first > b.first : a.second < b.second;
+    });
+    candidates.resize(limit);
+    for (int k = 0; k < limit; k++) {
+        candidates[k] = votes[k].second;
+    }
+}
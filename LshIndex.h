@@ -0,0 +1,41 @@
+#ifndef LSH_INDEX_H
+#define LSH_INDEX_H
+
+#include "UtilityMatrix.h"
+#include "SimilarityCalculator.h"
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// Índice de hashing sensible a la localidad para proponer vecinos candidatos
+// sin comparar todos los pares. Cada tabla resume la fila de un usuario en
+// una clave de numBits proyecciones aleatorias:
+//   - Coseno: signo de la proyección (SimHash, hiperplanos aleatorios)
+//   - Pearson: igual, sobre las calificaciones centradas en la media
+//   - Euclídea: proyección cuantizada en cubetas de ancho fijo (p-estable)
+// Las proyecciones se generan a partir de la semilla, así que el mismo
+// archivo, parámetros y semilla dan siempre los mismos candidatos
+class LshIndex {
+private:
+    int numTables;
+    int numBits;
+    uint64_t seed;
+    int numUsers;
+    // Usuarios de cada tabla ordenados por clave y posición de cada usuario
+    vector<int> order;
+    vector<int> position;
+    vector<uint64_t> keys;
+    
+public:
+    LshIndex(int numTables, int numBits, uint64_t seed);
+    void build(const UtilityMatrix& matrix, Metric metric, int numThreads);
+    // Usuarios que comparten cubeta con 'user' en alguna tabla, como mucho
+    // 'window' a cada lado en el orden de la tabla. Si hay más de 'limit', se
+    // quedan los que coinciden en más tablas. Sin repetidos ni el propio usuario.
+    // votes es memoria de trabajo del llamador (una por hilo)
+    void getCandidates(int user, int window, int limit, vector<int>& candidates,
+                       vector<pair<int, int>>& votes) const;
+};
+
+#endif
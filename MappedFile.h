@@ -0,0 +1,29 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+// Archivo proyectado en memoria de solo lectura (mmap). Se libera al destruirse
+class MappedFile {
+private:
+    int fd;
+    char* bytes;
+    size_t length;
+    
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    
+    bool open(const string& filename);
+    void close();
+    bool isOpen() const;
+    const char* data() const;
+    size_t size() const;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#include "NeighborIndex.h"
+#include "ParallelFor.h"
+#include <algorithm>
+
+using namespace std;
+
+bool neighborBefore(const pair<int, double>& a, const pair<int, double>& b) {
+    if (a.second != b.second) return a.second > b.second;
+    return a.first < b.first;
+}
+
+bool entryBefore(const Neighbor& a, const Neighbor& b) {
+    if (a.similarity != b.similarity) return a.similarity > b.similarity;
+    return a.id < b.id;
+}
+
+NeighborIndex::NeighborIndex() : numUsers(0), listLength(0), skipZero(false) {}
+
+void NeighborIndex::build(const SimilarityMatrix& similarities, int maxLength, int numThreads, bool skipZero) {
+    assign(similarities.size(), maxLength, skipZero);
+    
+    vector<int> users(numUsers);
+    for (int user = 0; user < numUsers; user++) {
+        users[user] = user;
+    }
+    rebuild(similarities, users, numThreads);
+}
+
+void NeighborIndex::rebuild(const SimilarityMatrix& similarities, const vector<int>& users, int numThreads) {
+    int threads = resolveThreadCount(numThreads);
+    // Cada hilo reserva una vez los candidatos de un usuario completo
+    vector<vector<pair<int, double>>> scratch(threads);
+    for (auto& candidates : scratch) candidates.reserve(numUsers);
+    
+    parallelFor(0, (int)users.size(), threads, 16, [&](int u, int thread) {
+        int user = users[u];
+        vector<pair<int, double>>& candidates = scratch[thread];
+        candidates.clear();
+        for (int other = 0; other < numUsers; other++) {
+            if (other == user) continue;
+            double similarity = similarities.get(user, other);
+            if (similarity != 0.0 || !skipZero) {
+                candidates.push_back({other, similarity});
+            }
+        }
+        setList(user, candidates);
+    });
+}
+
+void NeighborIndex::assign(int numUsers, int maxLength, bool skipZero) {
+    this->numUsers = numUsers;
+    this->skipZero = skipZero;
+    listLength = numUsers > 0 ? numUsers - 1 : 0;
+    if (maxLength > 0 && maxLength < listLength) {
+        listLength = maxLength;
+    }
+    entries.assign((size_t)numUsers * listLength, Neighbor{-1, 0.0f});
+    heapSizes.assign(numUsers, 0);
+}
+
+void NeighborIndex::setList(int user, vector<pair<int, double>>& candidates) {
+    if (skipZero) {
+        candidates.erase(remove_if(candidates.begin(), candidates.end(),
+                                   [](const pair<int, double>& c) { return c.second == 0.0; }),
+                         candidates.end());
+    }
+    // Si la lista se trunca, basta con ordenar los listLength mejores
+    if ((int)candidates.size() > listLength) {
+        nth_element(candidates.begin(), candidates.begin() + listLength, candidates.end(), neighborBefore);
+        candidates.resize(listLength);
+    }
+    sort(candidates.begin(), candidates.end(), neighborBefore);
+    Neighbor* out = entries.data() + (size_t)user * listLength;
+    for (size_t r = 0; r < candidates.size(); r++) {
+        out[r] = Neighbor{candidates[r].first, (float)candidates[r].second};
+    }
+    fill(out + candidates.size(), out + listLength, Neighbor{-1, 0.0f});
+}
+
+void NeighborIndex::offer(int user, int other, double similarity) {
+    if (listLength == 0 || (skipZero && similarity == 0.0)) return;
+    
+    // La cima del montículo es el peor de los candidatos guardados
+    Neighbor* heap = entries.data() + (size_t)user * listLength;
+    int& count = heapSizes[user];
+    Neighbor candidate = {other, (float)similarity};
+    if (count < listLength) {
+        heap[count++] = candidate;
+        push_heap(heap, heap + count, entryBefore);
+    } else if (entryBefore(candidate, heap[0])) {
+        pop_heap(heap, heap + count, entryBefore);
+        heap[count - 1] = candidate;
+        push_heap(heap, heap + count, entryBefore);
+    }
+}
+
+void NeighborIndex::finishOffers(int numThreads) {
+    parallelFor(0, numUsers, numThreads, 256, [&](int user, int) {
+        Neighbor* heap = entries.data() + (size_t)user * listLength;
+        sort_heap(heap, heap + heapSizes[user], entryBefore);
+    });
+    vector<int>().swap(heapSizes);
+}
+
+int NeighborIndex::getListLength() const {
+    return listLength;
+}
+
+long long NeighborIndex::countEntries() const {
+    long long count = 0;
+    for (const auto& entry : entries) {
+        if (entry.id >= 0) count++;
+    }
+    return count;
+}
+
+bool NeighborIndex::isTruncated() const {
+    return listLength < numUsers - 1;
+}
+
+size_t NeighborIndex::memoryBytes() const {
+    return entries.size() * sizeof(Neighbor);
+}
+
+const Neighbor* NeighborIndex::getList(int user) const {
+    return entries.data() + (size_t)user * listLength;
+}
@@ -0,0 +1,63 @@
+#ifndef NEIGHBOR_INDEX_H
+#define NEIGHBOR_INDEX_H
+
+#include "SimilarityMatrix.h"
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+// Entrada de una lista de vecinos: id (-1 = hueco) y similitud en float,
+// 8 bytes frente a los 16 de pair<int, double>
+struct Neighbor {
+    int id;
+    float similarity;
+};
+
+// Longitud de las listas si no se indica con -l, en memoria y en el modo
+// fuera de memoria: las listas completas ocupan U x (U - 1) entradas, más
+// que el triángulo de similitudes
+const int kDefaultListLength = 50;
+
+// Lista de vecinos de cada usuario ordenada por similitud descendente,
+// construida una vez tras calcular las similitudes. Cada lista guarda como
+// mucho maxLength vecinos (0 = todos los demás usuarios)
+class NeighborIndex {
+private:
+    int numUsers;
+    int listLength;
+    vector<Neighbor> entries;
+    // Con poda, los pares de similitud 0 no entran en las listas
+    bool skipZero;
+    // Entradas ocupadas de cada lista mientras se construye con offer
+    vector<int> heapSizes;
+    
+public:
+    NeighborIndex();
+    void build(const SimilarityMatrix& similarities, int maxLength, int numThreads, bool skipZero = false);
+    // Reordena solo las listas de los usuarios indicados
+    void rebuild(const SimilarityMatrix& similarities, const vector<int>& users, int numThreads);
+    // Reserva listas vacías para construirlas desde candidatos con setList
+    void assign(int numUsers, int maxLength, bool skipZero = false);
+    // Ordena los candidatos y guarda los listLength mejores (la similitud se
+    // redondea a float); si hay menos, el resto de la lista queda con id -1
+    void setList(int user, vector<pair<int, double>>& candidates);
+    // Construcción incremental tras assign: cada lista es un montículo acotado
+    // que conserva los listLength mejores candidatos ofrecidos. Ofrecer a
+    // listas distintas desde hilos distintos es seguro
+    void offer(int user, int other, double similarity);
+    // Ordena las listas construidas con offer
+    void finishOffers(int numThreads);
+    int getListLength() const;
+    // Entradas ocupadas en todas las listas
+    long long countEntries() const;
+    bool isTruncated() const;
+    size_t memoryBytes() const;
+    const Neighbor* getList(int user) const;
+};
+
+// Orden de los vecinos: similitud descendente y, a igualdad, id ascendente
+bool neighborBefore(const pair<int, double>& a, const pair<int, double>& b);
+bool entryBefore(const Neighbor& a, const Neighbor& b);
+
+#endif
@@ -0,0 +1,56 @@
+#include "PairSums.h"
+#include <utility>
+
+using namespace std;
+
+PairSums::PairSums() : numUsers(0) {}
+
+size_t PairSums::index(int i, int j) const {
+    size_t row = (size_t)i;
+    return row * (2 * (size_t)numUsers - row - 1) / 2 + (size_t)(j - i - 1);
+}
+
+void PairSums::resize(int n) {
+    numUsers = n;
+    CoRatedSums zero = {0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+    sums.assign(n > 1 ? (size_t)n * (n - 1) / 2 : 0, zero);
+}
+
+bool PairSums::empty() const {
+    return numUsers == 0;
+}
+
+void PairSums::set(int i, int j, const CoRatedSums& value) {
+    sums[index(i, j)] = value;
+}
+
+CoRatedSums PairSums::update(int user, int other, double ratingUser, double ratingOther, int sign) {
+    bool userIsX = user < other;
+    CoRatedSums& s = userIsX ? sums[index(user, other)] : sums[index(other, user)];
+    double x = userIsX ? ratingUser : ratingOther;
+    double y = userIsX ? ratingOther : ratingUser;
+    double diff = x - y;
+    
+    s.count += sign;
+    s.sumX += sign * x;
+    s.sumY += sign * y;
+    s.sumXX += sign * x * x;
+    s.sumYY += sign * y * y;
+    s.sumXY += sign * x * y;
+    s.sumDiff2 += sign * diff * diff;
+    if (s.count == 0) {
+        // Sin ítems comunes: descartar el residuo de redondeo
+        CoRatedSums zero = {0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+        s = zero;
+    }
+    
+    return userIsX ? s : get(user, other);
+}
+
+CoRatedSums PairSums::get(int user, int other) const {
+    if (user < other) return sums[index(user, other)];
+    CoRatedSums swapped = sums[index(other, user)];
+    swap(swapped.sumX, swapped.sumY);
+    swap(swapped.sumXX, swapped.sumYY);
+    return swapped;
+}
@@ -0,0 +1,33 @@
+#ifndef PAIR_SUMS_H
+#define PAIR_SUMS_H
+
+#include "SimilarityKernels.h"
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Sumas co-calificadas de cada par de usuarios (triángulo superior), para
+// poder corregir las similitudes cuando cambia una calificación sin volver a
+// recorrer las filas. En el par (i, j) con i < j, x es el usuario i
+class PairSums {
+private:
+    int numUsers;
+    vector<CoRatedSums> sums;
+    
+    size_t index(int i, int j) const;
+    
+public:
+    PairSums();
+    void resize(int n);
+    bool empty() const;
+    void set(int i, int j, const CoRatedSums& value);
+    // Quita (sign = -1) o añade (sign = +1) el ítem con calificaciones
+    // ratingUser de 'user' y ratingOther de 'other'. Devuelve las sumas
+    // del par orientadas con x = user
+    CoRatedSums update(int user, int other, double ratingUser, double ratingOther, int sign);
+    // Sumas del par orientadas con x = user
+    CoRatedSums get(int user, int other) const;
+};
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Número de hilos efectivo: 0 significa usar todos los núcleos disponibles
+inline int resolveThreadCount(int requested) {
+    if (requested > 0) return requested;
+    unsigned int hw = thread::hardware_concurrency();
+    return hw > 0 ? (int)hw : 1;
+}
+
+// Ejecuta body(i, hilo) para cada i en [begin, end). Los índices se reparten
+// dinámicamente en bloques de 'chunk', de modo que los hilos que terminan
+// antes toman más trabajo (balanceo de carga con filas de coste desigual)
+template <typename Body>
+void parallelFor(int begin, int end, int numThreads, int chunk, Body body) {
+    int threads = resolveThreadCount(numThreads);
+    if (chunk < 1) chunk = 1;
+    if (threads > (end - begin + chunk - 1) / chunk) {
+        threads = (end - begin + chunk - 1) / chunk;
+    }
+    
+    if (threads <= 1) {
+        for (int i = begin; i < end; i++) {
+            body(i, 0);
+        }
+        return;
+    }
+    
+    atomic<int> next(begin);
+    auto worker = [&](int threadId) {
+        for (;;) {
+            int first = next.fetch_add(chunk);
+            if (first >= end) break;
+            int last = first + chunk < end ? first + chunk : end;
+            for (int i = first; i < last; i++) {
+                body(i, threadId);
+            }
+        }
+    };
+    
+    vector<thread> pool;
+    for (int t = 1; t < threads; t++) {
+        pool.push_back(thread(worker, t));
+    }
+    worker(0);
+    for (size_t t = 0; t < pool.size(); t++) {
+        pool[t].join();
+    }
+}
+
+#endif
@@ -0,0 +1,80 @@
+#include "PredictionSet.h"
+#include "ParallelFor.h"
+#include <algorithm>
+
+using namespace std;
+
+PredictionSet::PredictionSet() : numUsers(0) {}
+
+void PredictionSet::build(const UtilityMatrix& matrix, int numThreads) {
+    numUsers = matrix.getNumUsers();
+    int numItems = matrix.getNumItems();
+    userStart.assign(numUsers + 1, 0);
+    for (int user = 0; user < numUsers; user++) {
+        userStart[user + 1] = userStart[user] + (numItems - matrix.getUserRow(user).size);
+    }
+    
+    int64_t total = userStart[numUsers];
+    items.resize(total);
+    values.assign(total, 0.0);
+    numerators.assign(total, 0.0);
+    denominators.assign(total, 0.0);
+    
+    // Complemento de cada fila: los items que el usuario no calificó
+    parallelFor(0, numUsers, numThreads, 64, [&](int user, int) {
+        SparseRow row = matrix.getUserRow(user);
+        int64_t out = userStart[user];
+        for (int item = 0, r = 0; item < numItems; item++) {
+            if (r < row.size && row.index[r] == item) {
+                r++;
+            } else {
+                items[out++] = item;
+            }
+        }
+    });
+}
+
+int PredictionSet::getNumUsers() const {
+    return numUsers;
+}
+
+int64_t PredictionSet::size() const {
+    return items.size();
+}
+
+int64_t PredictionSet::userBegin(int user) const {
+    return userStart[user];
+}
+
+int64_t PredictionSet::userEnd(int user) const {
+    return userStart[user + 1];
+}
+
+int64_t PredictionSet::find(int user, int item) const {
+    vector<int>::const_iterator first = items.begin() + userStart[user];
+    vector<int>::const_iterator last = items.begin() + userStart[user + 1];
+    vector<int>::const_iterator it = lower_bound(first, last, item);
+    return (it != last && *it == item) ? (int64_t)(it - items.begin()) : -1;
+}
+
+int PredictionSet::getItem(int64_t k) const {
+    return items[k];
+}
+
+double PredictionSet::getValue(int64_t k) const {
+    return values[k];
+}
+
+double PredictionSet::getNumerator(int64_t k) const {
+    return numerators[k];
+}
+
+double PredictionSet::getDenominator(int64_t k) const {
+    return denominators[k];
+}
+
+void PredictionSet::setValue(int64_t k, double value, double numerator, double denominator) {
+    values[k] = value;
+    numerators[k] = numerator;
+    denominators[k] = denominator;
+}
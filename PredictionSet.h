@@ -0,0 +1,41 @@
+#ifndef PREDICTION_SET_H
+#define PREDICTION_SET_H
+
+#include "UtilityMatrix.h"
+#include <vector>
+#include <stdint.h>
+
+using namespace std;
+
+// Resultados de la fase de predicción: las celdas vacías de cada usuario en
+// formato CSR, con el valor predicho y el numerador y denominador de la
+// media ponderada (para el informe). Es una capa sobre la matriz observada,
+// que no se modifica: los resultados solo dependen de las calificaciones
+// observadas y siguen siendo válidos mientras estas no cambien
+class PredictionSet {
+private:
+    int numUsers;
+    vector<int64_t> userStart;
+    vector<int> items;
+    vector<double> values;
+    vector<double> numerators;
+    vector<double> denominators;
+    
+public:
+    PredictionSet();
+    // Reserva una entrada por cada celda vacía de la matriz
+    void build(const UtilityMatrix& matrix, int numThreads);
+    int getNumUsers() const;
+    int64_t size() const;
+    int64_t userBegin(int user) const;
+    int64_t userEnd(int user) const;
+    // Posición de la predicción de (user, item), o -1 si la celda no es vacía
+    int64_t find(int user, int item) const;
+    int getItem(int64_t k) const;
+    double getValue(int64_t k) const;
+    double getNumerator(int64_t k) const;
+    double getDenominator(int64_t k) const;
+    void setValue(int64_t k, double value, double numerator, double denominator);
+};
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// Generador splitmix64: reproducible en cualquier plataforma, a diferencia
+// de las distribuciones de la biblioteca estándar
+inline uint64_t nextRandom(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniforme en (0, 1)
+inline double nextUniform(uint64_t& state) {
+    return ((nextRandom(state) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+#endif
@@ -0,0 +1,42 @@
+#include "RecommendationSet.h"
+
+using namespace std;
+
+RecommendationSet::RecommendationSet() : numUsers(0), perUser(0) {}
+
+void RecommendationSet::resize(int numUsers, int perUser) {
+    this->numUsers = numUsers;
+    this->perUser = perUser;
+    counts.assign(numUsers, 0);
+    items.assign((size_t)numUsers * perUser, -1);
+    ratings.assign((size_t)numUsers * perUser, 0.0);
+}
+
+int RecommendationSet::getNumUsers() const {
+    return numUsers;
+}
+
+int RecommendationSet::getPerUser() const {
+    return perUser;
+}
+
+int RecommendationSet::getCount(int user) const {
+    return counts[user];
+}
+
+int RecommendationSet::getItem(int user, int rank) const {
+    return items[(size_t)user * perUser + rank];
+}
+
+double RecommendationSet::getRating(int user, int rank) const {
+    return ratings[(size_t)user * perUser + rank];
+}
+
+void RecommendationSet::set(int user, const pair<int, double>* best, int count) {
+    size_t base = (size_t)user * perUser;
+    for (int r = 0; r < count; r++) {
+        items[base + r] = best[r].first;
+        ratings[base + r] = best[r].second;
+    }
+    counts[user] = count;
+}
@@ -0,0 +1,32 @@
+#ifndef RECOMMENDATION_SET_H
+#define RECOMMENDATION_SET_H
+
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+// Las n mejores recomendaciones de cada usuario, en bloques de tamaño fijo
+// ordenados por calificación predicha descendente. Solo contiene ítems que
+// el usuario no ha calificado; un usuario puede tener menos de n
+class RecommendationSet {
+private:
+    int numUsers;
+    int perUser;
+    vector<int> counts;
+    vector<int> items;
+    vector<double> ratings;
+    
+public:
+    RecommendationSet();
+    void resize(int numUsers, int perUser);
+    int getNumUsers() const;
+    int getPerUser() const;
+    int getCount(int user) const;
+    int getItem(int user, int rank) const;
+    double getRating(int user, int rank) const;
+    // Guarda los count primeros pares (item, calificación), ya ordenados
+    void set(int user, const pair<int, double>* best, int count);
+};
+
+#endif
@@ -1,95 +1,566 @@
 #include "RecommenderSystem.h"
+#include "ParallelFor.h"
+#include "LshIndex.h"
+#include "BlockedPairs.h"
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
 #include <cmath>
 #include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdarg>
+#include <chrono>
 
 using namespace std;
 
-RecommenderSystem::RecommenderSystem(const string& filename, Metric m, int k, PredictionType pt) 
-    : metric(m), numNeighbors(k), predictionType(pt) {
+// Candidatos por lista de vecinos aproximada a los que se calcula la similitud
+static const int kLshCandidateFactor = 4;
+// Tamaño máximo de la tesela de similitudes al construir solo las listas top-K
+static const size_t kTopKTileBytes = 64 << 20;
+// Usuarios con los que se compara el resultado aproximado para medir el recall
+static const int kRecallSampleSize = 1000;
+// Recall por debajo del cual se sugiere cambiar los parámetros de LSH
+static const double kLowRecall = 0.5;
+
+// Bits por tabla LSH si no se indican: cubetas de unos 4 x -l / tablas
+// usuarios, para que la unión de las tablas dé del orden de los candidatos
+// que se evalúan. Con pocas claves sobran bits: cada cubeta queda casi vacía
+static int defaultLshBits(int numUsers, int numTables, int listLength) {
+    double buckets = (double)numUsers * numTables / ((double)kLshCandidateFactor * listLength);
+    int bits = 1;
+    while (bits < 64 && ldexp(1.0, bits + 1) <= buckets) bits++;
+    return bits;
+}
+
+RecommenderOptions::RecommenderOptions()
+    : mode(USER_BASED), engine(ENGINE_PAIRWISE), storage(STORAGE_DOUBLE), metric(PEARSON), numNeighbors(3), predictionType(SIMPLE), numThreads(0), neighborListLength(kDefaultListLength),
+      reportFormat(REPORT_TEXT), topItems(5), lshTables(0), lshBits(0), seed(1), lshRecall(false), stats(false) {}
+
+RecommenderSystem::RecommenderSystem(const string& filename, const RecommenderOptions& options) 
+    : mode(options.mode), engine(options.engine), storage(options.storage), metric(options.metric), numNeighbors(options.numNeighbors),
+      predictionType(options.predictionType), numThreads(options.numThreads),
+      neighborListLength(options.neighborListLength), similarityCache(options.similarityCache),
+      updatesFile(options.updatesFile), reportFormat(options.reportFormat),
+      topItems(options.topItems), lshTables(options.lshTables), lshBits(options.lshBits),
+      seed(options.seed), lshRecall(options.lshRecall), filter(options.filter) {
     
-    if (!matrix.loadFromFile(filename)) {
+    if (options.stats) stats.enable();
+    stats.begin(STATS_LOAD);
+    if (!matrix.loadFromFile(filename, numThreads)) {
         throw runtime_error("Error al cargar la matriz de utilidad");
     }
+    
+    if (mode == ITEM_BASED) {
+        itemMatrix.transposeFrom(matrix);
+    }
+    stats.end();
+    // Sin matriz de similitudes (LSH o top-K) las listas deben estar acotadas
+    if ((lshTables > 0 || storage == STORAGE_TOPK) && neighborListLength == 0) {
+        neighborListLength = kDefaultListLength;
+    }
+    if (lshTables > 0 && lshBits == 0) {
+        lshBits = defaultLshBits(model().getNumUsers(), lshTables, neighborListLength);
+    }
 }
 
-void RecommenderSystem::calculateAllSimilarities() {
-    SimilarityCalculator calc(matrix, metric);
-    similarities.resize(matrix.getNumUsers(), vector<double>(matrix.getNumUsers(), 0.0));
+const UtilityMatrix& RecommenderSystem::model() const {
+    return mode == ITEM_BASED ? itemMatrix : matrix;
+}
+
+UtilityMatrix& RecommenderSystem::model() {
+    return mode == ITEM_BASED ? itemMatrix : matrix;
+}
+
+const char* RecommenderSystem::entityName() const {
+    return mode == ITEM_BASED ? "Item" : "Usuario";
+}
+
+template <typename M>
+void RecommenderSystem::calculateAllSimilaritiesWith() {
+    SimilarityCalculator calc(model(), metric, filter);
+    int n = model().getNumUsers();
+    similarities.resize(n, storage == STORAGE_FLOAT);
     
-    for (int i = 0; i < matrix.getNumUsers(); i++) {
-        for (int j = 0; j < matrix.getNumUsers(); j++) {
-            if (i != j) {
-                similarities[i][j] = calc.calculateSimilarity(i, j);
+    // Si se van a aplicar actualizaciones, se guardan también las sumas de cada par
+    bool keepSums = !updatesFile.empty();
+    if (keepSums) {
+        pairSums.resize(n);
+    }
+    stats.count(COUNT_PAIRS, n > 1 ? (long long)n * (n - 1) / 2 : 0);
+    
+    // Motor por bloques: las sumas de todos los pares salen de paneles de
+    // usuarios, con más operaciones por byte leído que el recorrido por pares
+    if (engine == ENGINE_BLOCKED) {
+        long long coRated = 0;
+        forEachPairBlocked(model(), numThreads, [&](int i, int j, const CoRatedSums& sums) {
+            if (keepSums) pairSums.set(i, j, sums);
+            similarities.set(i, j, calc.similarityFromSums<M>(i, j, sums));
+        }, &coRated);
+        stats.count(COUNT_CO_RATED, coRated);
+        return;
+    }
+    
+    // Las tres métricas son simétricas: solo se calcula el triángulo superior.
+    // La fila i tiene n-i-1 pares, así que las primeras son las más caras y se
+    // reparten de una en una para equilibrar la carga entre hilos
+    // Los contadores salen del mismo recorrido, con o sin --stats
+    parallelFor(0, n, numThreads, 1, [&](int i, int) {
+        long long coRated = 0, skipped = 0;
+        for (int j = i + 1; j < n; j++) {
+            if (keepSums) {
+                CoRatedSums sums;
+                calc.coRatedSums(i, j, sums);
+                pairSums.set(i, j, sums);
+                coRated += sums.count;
+                similarities.set(i, j, calc.similarityFromSums<M>(i, j, sums));
+            } else {
+                int found;
+                similarities.set(i, j, calc.similarity<M>(i, j, &found));
+                if (found >= 0) coRated += found; else skipped++;
             }
         }
-    }
+        stats.count(COUNT_CO_RATED, coRated);
+        stats.count(COUNT_SKIPPED, skipped);
+    });
 }
 
-vector<pair<int, double>> RecommenderSystem::getNeighbors(int user, int item, int k) const {
-    vector<pair<int, double>> neighbors;
+template <typename M>
+void RecommenderSystem::calculateTopNeighborsWith() {
+    const UtilityMatrix& space = model();
+    SimilarityCalculator calc(space, metric, filter);
+    int n = space.getNumUsers();
+    neighborIndex.assign(n, neighborListLength, filter.prunes());
     
-    for (int i = 0; i < matrix.getNumUsers(); i++) {
-        if (i != user && !matrix.isMissing(i, item)) {
-            neighbors.push_back({i, similarities[user][i]});
+    // Por bloques de filas del triángulo superior: la tesela del bloque se
+    // ofrece primero a las listas de sus filas y después a las de sus columnas,
+    // así que cada lista la actualiza un solo hilo en cada fase
+    int rows = (int)max<size_t>(1, kTopKTileBytes / sizeof(double) / max(1, n));
+    stats.count(COUNT_PAIRS, n > 1 ? (long long)n * (n - 1) / 2 : 0);
+    vector<double> tile;
+    for (int first = 0; first < n; first += rows) {
+        int last = min(n, first + rows);
+        tile.assign((size_t)(last - first) * n, 0.0);
+        if (engine == ENGINE_BLOCKED) {
+            long long coRated = 0;
+            forEachPairBlocked(space, first, last, numThreads, [&](int i, int j, const CoRatedSums& sums) {
+                tile[(size_t)(i - first) * n + j] = calc.similarityFromSums<M>(i, j, sums);
+            }, &coRated);
+            stats.count(COUNT_CO_RATED, coRated);
+        } else {
+            parallelFor(first, last, numThreads, 1, [&](int i, int) {
+                long long coRated = 0, skipped = 0;
+                for (int j = i + 1; j < n; j++) {
+                    int found;
+                    tile[(size_t)(i - first) * n + j] = calc.similarity<M>(i, j, &found);
+                    if (found >= 0) coRated += found; else skipped++;
+                }
+                stats.count(COUNT_CO_RATED, coRated);
+                stats.count(COUNT_SKIPPED, skipped);
+            });
         }
+        
+        parallelFor(first, last, numThreads, 16, [&](int i, int) {
+            for (int j = i + 1; j < n; j++) {
+                neighborIndex.offer(i, j, tile[(size_t)(i - first) * n + j]);
+            }
+        });
+        parallelFor(first + 1, n, numThreads, 16, [&](int j, int) {
+            for (int i = first; i < min(j, last); i++) {
+                neighborIndex.offer(j, i, tile[(size_t)(i - first) * n + j]);
+            }
+        });
     }
+    neighborIndex.finishOffers(numThreads);
+}
+
+template <typename M>
+void RecommenderSystem::calculateApproximateNeighborsWith() {
+    const UtilityMatrix& space = model();
+    SimilarityCalculator calc(space, metric, filter);
+    int n = space.getNumUsers();
     
-    // Ordenar por similitud descendente
-    sort(neighbors.begin(), neighbors.end(), 
-         [](const pair<int, double>& a, const pair<int, double>& b) {
-             return a.second > b.second;
-         });
+    LshIndex lsh(lshTables, lshBits, seed);
+    lsh.build(space, metric, numThreads);
     
-    // Tomar solo k vecinos
-    if (neighbors.size() > (size_t)k) {
-        neighbors.resize(k);
+    // Similitud exacta solo con los candidatos que comparten cubeta; de cada
+    // tabla se toman como mucho neighborListLength a cada lado
+    neighborIndex.assign(n, neighborListLength, filter.prunes());
+    int threads = resolveThreadCount(numThreads);
+    vector<vector<int>> candidates(threads);
+    vector<vector<pair<int, int>>> votes(threads);
+    vector<vector<pair<int, double>>> scored(threads);
+    vector<long long> evaluated(threads, 0);
+    parallelFor(0, n, threads, 16, [&](int user, int thread) {
+        lsh.getCandidates(user, neighborListLength, kLshCandidateFactor * neighborListLength,
+                          candidates[thread], votes[thread]);
+        scored[thread].clear();
+        long long coRated = 0, skipped = 0;
+        for (int other : candidates[thread]) {
+            int found;
+            scored[thread].push_back({other, calc.similarity<M>(user, other, &found)});
+            if (found >= 0) coRated += found; else skipped++;
+        }
+        stats.count(COUNT_CO_RATED, coRated);
+        stats.count(COUNT_SKIPPED, skipped);
+        evaluated[thread] += candidates[thread].size();
+        neighborIndex.setList(user, scored[thread]);
+    });
+    
+    long long total = 0;
+    for (long long count : evaluated) total += count;
+    stats.count(COUNT_PAIRS, total);
+    double allPairs = (double)n * (n - 1);
+    clog << "LSH: " << lshTables << " tablas x " << lshBits << " bits, semilla " << seed << endl;
+    clog << fixed << setprecision(1) << "Candidatos por " << (mode == ITEM_BASED ? "ítem" : "usuario")
+         << ": " << (n > 0 ? (double)total / n : 0.0) << " de media ("
+         << (allPairs > 0 ? 100.0 * total / allPairs : 0.0) << "% de los pares)" << endl;
+}
+
+// La métrica se elige una sola vez por fase: los bucles sobre todos los pares
+// se compilan especializados en cada una
+void RecommenderSystem::calculateAllSimilarities() {
+    switch (metric) {
+        case PEARSON: calculateAllSimilaritiesWith<PearsonMetric>(); break;
+        case COSINE: calculateAllSimilaritiesWith<CosineMetric>(); break;
+        case EUCLIDEAN: calculateAllSimilaritiesWith<EuclideanMetric>(); break;
+        case JACCARD: calculateAllSimilaritiesWith<JaccardMetric>(); break;
+    }
+}
+
+void RecommenderSystem::calculateTopNeighbors() {
+    switch (metric) {
+        case PEARSON: calculateTopNeighborsWith<PearsonMetric>(); break;
+        case COSINE: calculateTopNeighborsWith<CosineMetric>(); break;
+        case EUCLIDEAN: calculateTopNeighborsWith<EuclideanMetric>(); break;
+        case JACCARD: calculateTopNeighborsWith<JaccardMetric>(); break;
+    }
+}
+
+void RecommenderSystem::calculateApproximateNeighbors() {
+    switch (metric) {
+        case PEARSON: calculateApproximateNeighborsWith<PearsonMetric>(); break;
+        case COSINE: calculateApproximateNeighborsWith<CosineMetric>(); break;
+        case EUCLIDEAN: calculateApproximateNeighborsWith<EuclideanMetric>(); break;
+        case JACCARD: calculateApproximateNeighborsWith<JaccardMetric>(); break;
+    }
+}
+
+void RecommenderSystem::reportNeighborRecall() const {
+    const UtilityMatrix& space = model();
+    SimilarityCalculator calc(space, metric, filter);
+    int n = space.getNumUsers();
+    int length = neighborIndex.getListLength();
+    
+    // Muestra reproducible de usuarios (todos si son pocos)
+    vector<int> sample(n);
+    for (int u = 0; u < n; u++) sample[u] = u;
+    if (n > kRecallSampleSize) {
+        uint64_t state = seed;
+        for (int i = 0; i < kRecallSampleSize; i++) {
+            state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+            swap(sample[i], sample[i + (int)((state >> 33) % (uint64_t)(n - i))]);
+        }
+        sample.resize(kRecallSampleSize);
     }
     
-    return neighbors;
+    // Recall@L: fracción de los L vecinos exactos que aparecen en la lista aproximada
+    int threads = resolveThreadCount(numThreads);
+    vector<vector<pair<int, double>>> exact(threads);
+    vector<long long> found(threads, 0), expected(threads, 0);
+    parallelFor(0, (int)sample.size(), threads, 4, [&](int s, int thread) {
+        int user = sample[s];
+        vector<pair<int, double>>& best = exact[thread];
+        best.clear();
+        for (int other = 0; other < n; other++) {
+            if (other == user) continue;
+            double similarity = calc.calculateSimilarity(user, other);
+            // Los pares podados tampoco cuentan entre los vecinos exactos
+            if (similarity != 0.0 || !filter.prunes()) best.push_back({other, similarity});
+        }
+        int count = min(length, (int)best.size());
+        partial_sort(best.begin(), best.begin() + count, best.end(), neighborBefore);
+        
+        const Neighbor* list = neighborIndex.getList(user);
+        for (int r = 0; r < count; r++) {
+            for (int a = 0; a < length && list[a].id >= 0; a++) {
+                if (list[a].id == best[r].first) {
+                    found[thread]++;
+                    break;
+                }
+            }
+        }
+        expected[thread] += count;
+    });
+    
+    long long hits = 0, total = 0;
+    for (int t = 0; t < threads; t++) {
+        hits += found[t];
+        total += expected[t];
+    }
+    double recall = total > 0 ? (double)hits / total : 1.0;
+    clog << fixed << setprecision(3) << "Recall@" << length << " frente al cálculo exacto: "
+         << recall << " (" << sample.size() << " de " << n << ")" << endl;
+    if (recall < kLowRecall) {
+        clog << "Aviso: recall bajo; pruebe con menos bits por tabla (--lsh-bits) o más tablas (-L)" << endl;
+    }
+}
+
+void RecommenderSystem::calculatePairSums() {
+    SimilarityCalculator calc(model(), metric, filter);
+    int n = model().getNumUsers();
+    pairSums.resize(n);
+    if (engine == ENGINE_BLOCKED) {
+        forEachPairBlocked(model(), numThreads, [&](int i, int j, const CoRatedSums& sums) {
+            pairSums.set(i, j, sums);
+        });
+        return;
+    }
+    parallelFor(0, n, numThreads, 1, [&](int i, int) {
+        for (int j = i + 1; j < n; j++) {
+            CoRatedSums sums;
+            calc.coRatedSums(i, j, sums);
+            pairSums.set(i, j, sums);
+        }
+    });
 }
 
-double RecommenderSystem::simplePrediction(int user, int item, const vector<pair<int, double>>& neighbors) const {
-    if (neighbors.empty()) return matrix.getUserMean(user);
+bool RecommenderSystem::readUpdates(const string& filename, vector<RatingUpdate>& updates) const {
+    ifstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: No se puede abrir el archivo " << filename << endl;
+        return false;
+    }
     
-    double numerator = 0.0, denominator = 0.0;
+    // Una actualización por línea: <usuario> <item> <calificación | ->
+    string line;
+    for (int lineNumber = 1; getline(file, line); lineNumber++) {
+        stringstream ss(line);
+        RatingUpdate update;
+        string value;
+        if (!(ss >> update.user)) continue; // línea vacía
+        if (!(ss >> update.item >> value) || update.user < 0 || update.user >= matrix.getNumUsers() ||
+            update.item < 0 || update.item >= matrix.getNumItems()) {
+            cerr << "Error: " << filename << ", línea " << lineNumber << ": actualización no válida" << endl;
+            return false;
+        }
+        if (value == "-") {
+            update.rating = -1.0;
+        } else {
+            char* end;
+            update.rating = strtod(value.c_str(), &end);
+            if (*end != '\0' || update.rating < 0.0) {
+                cerr << "Error: " << filename << ", línea " << lineNumber << ": calificación no válida '" << value << "'" << endl;
+                return false;
+            }
+        }
+        updates.push_back(update);
+    }
+    return true;
+}
+
+int RecommenderSystem::applyUpdates(const vector<RatingUpdate>& updates) {
+    UtilityMatrix& space = model();
+    SimilarityCalculator calc(space, metric, filter);
+    if (pairSums.empty()) {
+        calculatePairSums();
+    }
     
-    for (const auto& neighbor : neighbors) {
-        int neighborId = neighbor.first;
-        double similarity = neighbor.second;
-        double rating = matrix.getRating(neighborId, item);
+    vector<char> affected(space.getNumUsers(), 0);
+    for (const RatingUpdate& update : updates) {
+        int user = update.user, item = update.item;
+        if (mode == ITEM_BASED) swap(user, item);
+        bool hadRating = !space.isMissing(user, item);
+        bool hasRating = update.rating >= 0.0;
+        double oldRating = hadRating ? space.getRating(user, item) : 0.0;
+        double newRating = (float)update.rating; // misma precisión que la matriz
+        if (!hadRating && !hasRating) continue;
+        
+        // Solo cambian los pares con usuarios que también calificaron el item:
+        // se corrigen sus sumas y se recalcula la similitud a partir de ellas
+        SparseRow raters = space.getItemColumn(item);
+        for (int r = 0; r < raters.size; r++) {
+            int other = raters.index[r];
+            if (other == user) continue;
+            CoRatedSums sums;
+            if (hadRating) sums = pairSums.update(user, other, oldRating, raters.value[r], -1);
+            if (hasRating) sums = pairSums.update(user, other, newRating, raters.value[r], +1);
+            similarities.set(user, other, calc.similarityFromSums(user, other, sums));
+            affected[other] = 1;
+        }
+        stats.count(COUNT_PAIRS, raters.size);
+        affected[user] = 1;
+        
+        if (hasRating) {
+            space.setRating(user, item, newRating);
+        } else {
+            space.removeRating(user, item);
+        }
+        // En modo por ítems la matriz de usuarios también debe reflejar el cambio
+        if (mode == ITEM_BASED) {
+            if (hasRating) {
+                matrix.setRating(update.user, update.item, newRating);
+            } else {
+                matrix.removeRating(update.user, update.item);
+            }
+        }
         
-        numerator += similarity * rating;
-        denominator += abs(similarity);
+        // Jaccard depende también del número de calificaciones del usuario:
+        // si cambia, se recalculan todos sus pares con las sumas guardadas
+        if (metric == JACCARD && hadRating != hasRating) {
+            for (int other = 0; other < space.getNumUsers(); other++) {
+                if (other == user) continue;
+                similarities.set(user, other, calc.similarityFromSums(user, other, pairSums.get(user, other)));
+                affected[other] = 1;
+            }
+            stats.count(COUNT_PAIRS, space.getNumUsers() - 1);
+        }
     }
     
-    return denominator > 0.0 ? numerator / denominator : matrix.getUserMean(user);
+    // Reordenar solo las listas de vecinos afectadas
+    vector<int> users;
+    for (int u = 0; u < space.getNumUsers(); u++) {
+        if (affected[u]) users.push_back(u);
+    }
+    neighborIndex.rebuild(similarities, users, numThreads);
+    return users.size();
+}
+
+SnapshotKey RecommenderSystem::snapshotKey() const {
+    SnapshotKey key;
+    key.metric = metric;
+    key.valueBytes = storage == STORAGE_FLOAT ? sizeof(float) : sizeof(double);
+    key.matrixHash = model().contentHash(); // la traspuesta tiene otro hash
+    // La poda y la ponderación cambian los valores guardados
+    key.minOverlap = filter.minOverlap;
+    key.significance = filter.significance;
+    key.minSimilarity = filter.minSimilarity;
+    return key;
 }
 
-double RecommenderSystem::meanDiffPrediction(int user, int item, const vector<pair<int, double>>& neighbors) const {
-    if (neighbors.empty()) return matrix.getUserMean(user);
+bool RecommenderSystem::loadSimilaritySnapshot() {
+    if (similarityCache.empty()) return false;
+    if (!similarities.loadSnapshot(similarityCache, snapshotKey())) return false;
+    clog << "Similitudes cargadas desde " << similarityCache << endl;
+    return true;
+}
+
+void RecommenderSystem::saveSimilaritySnapshot() const {
+    if (similarityCache.empty()) return;
+    if (similarities.saveSnapshot(similarityCache, snapshotKey())) {
+        clog << "Similitudes guardadas en " << similarityCache << endl;
+    }
+}
+
+void RecommenderSystem::computeSimilarities() {
+    // Modo aproximado: las listas de vecinos salen directamente de los
+    // candidatos, sin matriz de similitudes completa
+    if (lshTables > 0) {
+        calculateApproximateNeighbors();
+        if (lshRecall) reportNeighborRecall();
+        return;
+    }
     
-    double userMean = matrix.getUserMean(user);
-    double numerator = 0.0, denominator = 0.0;
+    // Solo las listas top-K: la tesela de cada bloque se descarta tras usarla
+    if (storage == STORAGE_TOPK) {
+        calculateTopNeighbors();
+        return;
+    }
     
-    for (const auto& neighbor : neighbors) {
-        int neighborId = neighbor.first;
-        double similarity = neighbor.second;
-        double rating = matrix.getRating(neighborId, item);
-        double neighborMean = matrix.getUserMean(neighborId);
-        
-        numerator += similarity * (rating - neighborMean);
-        denominator += abs(similarity);
+    if (!loadSimilaritySnapshot()) {
+        calculateAllSimilarities();
+        saveSimilaritySnapshot();
+    }
+}
+
+void RecommenderSystem::buildNeighborIndex() {
+    // Con LSH o top-K las listas ya se construyeron junto con las similitudes
+    if (lshTables > 0 || storage == STORAGE_TOPK) return;
+    neighborIndex.build(similarities, neighborListLength, numThreads, filter.prunes());
+}
+
+void RecommenderSystem::buildModel() {
+    stats.begin(STATS_SIMILARITY);
+    computeSimilarities();
+    stats.end();
+    // Ordenar una vez los vecinos de cada usuario
+    stats.begin(STATS_NEIGHBORS);
+    buildNeighborIndex();
+    stats.end();
+    // La memoria del modelo es la del triángulo más la del índice: con -S float
+    // solo se reduce la primera, así que se muestran por separado
+    size_t triangleBytes = similarities.memoryBytes();
+    size_t indexBytes = neighborIndex.memoryBytes();
+    clog << fixed << setprecision(2) << "Memoria de similitudes: " << triangleBytes / 1048576.0 << " MB ";
+    if (similarities.size() > 0) {
+        clog << "(triángulo en " << (similarities.isSinglePrecision() ? "float, 4" : "double, 8") << " bytes por par)";
+    } else {
+        clog << "(sin matriz)";
+    }
+    clog << " + " << indexBytes / 1048576.0 << " MB (listas de vecinos, " << neighborIndex.getListLength()
+         << " x " << sizeof(Neighbor) << " bytes por " << (mode == ITEM_BASED ? "ítem" : "usuario") << ") = "
+         << (triangleBytes + indexBytes) / 1048576.0 << " MB" << endl;
+    if (filter.prunes()) {
+        int n = model().getNumUsers();
+        clog << fixed << setprecision(1) << "Vecinos tras la poda: "
+             << (n > 0 ? (double)neighborIndex.countEntries() / n : 0.0) << " de media por "
+             << (mode == ITEM_BASED ? "ítem" : "usuario") << endl;
     }
+}
+
+void RecommenderSystem::getNeighbors(int user, int item, int k, vector<pair<int, double>>& neighbors) const {
+    const UtilityMatrix& space = model();
+    neighbors.clear();
     
-    double prediction = userMean + (denominator > 0.0 ? numerator / denominator : 0.0);
+    // Recorrer la lista ordenada del usuario hasta encontrar k que calificaron el item
+    const Neighbor* list = neighborIndex.getList(user);
+    int length = neighborIndex.getListLength();
+    int r = 0;
+    for (; r < length && list[r].id >= 0 && (int)neighbors.size() < k; r++) {
+        if (!space.isMissing(list[r].id, item)) {
+            neighbors.push_back({list[r].id, list[r].similarity});
+        }
+    }
+    stats.count(COUNT_NEIGHBORS, r);
     
-    // Limitar predicción al rango válido
-    prediction = max(matrix.getMinRating(), min(matrix.getMaxRating(), prediction));
+    if ((int)neighbors.size() < k && needsRaterFallback()) {
+        getNeighborsFromRaters(user, item, k, neighbors);
+    }
+}
+
+bool RecommenderSystem::needsRaterFallback() const {
+    // Sin matriz de similitudes (modo aproximado o top-K) no hay a qué recurrir
+    return neighborIndex.isTruncated() && similarities.size() > 0;
+}
+
+void RecommenderSystem::getNeighborsFromRaters(int user, int item, int k, vector<pair<int, double>>& neighbors) const {
+    // Lista truncada sin suficientes vecinos: seleccionar los k mejores entre
+    // todos los usuarios que calificaron el item (índice CSC)
+    neighbors.clear();
+    SparseRow raters = model().getItemColumn(item);
+    for (int r = 0; r < raters.size; r++) {
+        int i = raters.index[r];
+        if (i == user) continue;
+        double similarity = similarities.get(user, i);
+        if (similarity != 0.0 || !filter.prunes()) {
+            neighbors.push_back({i, similarity});
+        }
+    }
+    stats.count(COUNT_NEIGHBORS, raters.size);
     
-    return prediction;
+    if (neighbors.size() > (size_t)k) {
+        partial_sort(neighbors.begin(), neighbors.begin() + k, neighbors.end(), neighborBefore);
+        neighbors.resize(k);
+    } else {
+        sort(neighbors.begin(), neighbors.end(), neighborBefore);
+    }
+    // Como en las listas: se ordena por la similitud exacta y se pondera con
+    // su redondeo a float
+    for (auto& neighbor : neighbors) {
+        neighbor.second = (float)neighbor.second;
+    }
 }
 
 void RecommenderSystem::run() {
@@ -99,11 +570,25 @@ void RecommenderSystem::run() {
     
     // Mostrar configuración
     cout << "\n=== CONFIGURACIÓN ===" << endl;
+    if (mode == ITEM_BASED) {
+        cout << "Modo: Basado en ítems (" << neighborListLength << " vecinos por ítem)" << endl;
+    } else {
+        cout << "Modo: Basado en usuarios" << endl;
+    }
+    if (engine == ENGINE_BLOCKED && lshTables == 0) {
+        cout << "Motor de similitudes: por bloques (" << coRatedKernelName() << ")" << endl;
+    }
+    if (storage == STORAGE_FLOAT && lshTables == 0) {
+        cout << "Similitudes: triángulo en float" << endl;
+    } else if (storage == STORAGE_TOPK && lshTables == 0) {
+        cout << "Similitudes: solo los " << neighborListLength << " mejores vecinos" << endl;
+    }
     cout << "Métrica: ";
     switch (metric) {
         case PEARSON: cout << "Correlación de Pearson" << endl; break;
         case COSINE: cout << "Distancia Coseno" << endl; break;
         case EUCLIDEAN: cout << "Distancia Euclídea" << endl; break;
+        case JACCARD: cout << "Índice de Jaccard" << endl; break;
     }
     cout << "Número de vecinos: " << numNeighbors << endl;
     cout << "Tipo de predicción: ";
@@ -117,43 +602,73 @@ void RecommenderSystem::run() {
     
     // Calcular similitudes
     cout << "\n=== CALCULANDO SIMILITUDES ===" << endl;
-    calculateAllSimilarities();
+    buildModel();
     
     // Mostrar matriz de similitudes
     printSimilarities();
     
+    // Aplicar actualizaciones de calificaciones corrigiendo solo lo afectado
+    if (!updatesFile.empty()) {
+        cout << "\n=== APLICANDO ACTUALIZACIONES ===" << endl;
+        vector<RatingUpdate> updates;
+        if (!readUpdates(updatesFile, updates)) {
+            throw runtime_error("Error al leer las actualizaciones");
+        }
+        stats.begin(STATS_UPDATES);
+        int affected = applyUpdates(updates);
+        stats.end();
+        cout << updates.size() << " actualizaciones aplicadas, " << affected
+             << (mode == ITEM_BASED ? " ítems afectados" : " usuarios afectados") << endl;
+    }
+    
     // Realizar predicciones
     cout << "\n=== REALIZANDO PREDICCIONES ===" << endl;
     makePredictions();
     
     // Mostrar matriz con predicciones
     cout << "\n=== MATRIZ DE UTILIDAD CON PREDICCIONES ===" << endl;
-    matrix.printPredictions();
+    matrix.printPredictions(predictions);
     
     // Generar recomendaciones
     cout << "\n=== RECOMENDACIONES POR USUARIO ===" << endl;
+    stats.begin(STATS_RECOMMENDATION);
     generateRecommendations();
+    stats.end();
+    printRecommendations();
+    
+    if (stats.isEnabled()) stats.write(clog);
 }
 
 void RecommenderSystem::printSimilarities() const {
     cout << "\n=== MATRIZ DE SIMILITUDES ===" << endl;
+    if (lshTables > 0) {
+        cout << "Modo aproximado: solo se guardan las listas de vecinos\n";
+        return;
+    }
+    if (storage == STORAGE_TOPK) {
+        cout << "Solo se guardan los " << neighborIndex.getListLength() << " mejores vecinos de cada "
+             << (mode == ITEM_BASED ? "ítem" : "usuario") << "\n";
+        return;
+    }
     if (matrix.getNumItems() >= 25 || matrix.getNumUsers() > 25) {
       cout << "Matriz demasiado grande, imprimiendo solo resultados\n";
       return;
     }
-    cout << setw(8) << "Usuario";
-    for (int j = 0; j < matrix.getNumUsers(); j++) {
-        cout << setw(10) << "U" + to_string(j);
+    int n = model().getNumUsers();
+    string prefix = mode == ITEM_BASED ? "I" : "U";
+    cout << setw(8) << entityName();
+    for (int j = 0; j < n; j++) {
+        cout << setw(10) << prefix + to_string(j);
     }
     cout << endl;
     
-    for (int i = 0; i < matrix.getNumUsers(); i++) {
-        cout << setw(8) << "U" + to_string(i);
-        for (int j = 0; j < matrix.getNumUsers(); j++) {
+    for (int i = 0; i < n; i++) {
+        cout << setw(8) << prefix + to_string(i);
+        for (int j = 0; j < n; j++) {
             if (i == j) {
                 cout << setw(10) << "1.000";
             } else {
-                cout << setw(10) << fixed << setprecision(3) << similarities[i][j];
+                cout << setw(10) << fixed << setprecision(3) << similarities.get(i, j);
             }
         }
         cout << endl;
@@ -161,7 +676,422 @@ void RecommenderSystem::printSimilarities() const {
     cout << endl;
 }
 
-void RecommenderSystem::makePredictions() {
+// Políticas de predicción: término de cada vecino y combinación final con
+// la media del usuario. Se eligen una vez por fase, no en cada celda
+struct SimplePolicy {
+    static const bool usesNeighborMean = false;
+    static double term(double similarity, double rating, double) {
+        return similarity * rating;
+    }
+    static double finish(double userMean, double numerator, double denominator, double, double) {
+        return denominator > 0.0 ? numerator / denominator : userMean;
+    }
+};
+
+struct MeanDiffPolicy {
+    static const bool usesNeighborMean = true;
+    static double term(double similarity, double rating, double neighborMean) {
+        return similarity * (rating - neighborMean);
+    }
+    static double finish(double userMean, double numerator, double denominator, double minRating, double maxRating) {
+        double prediction = userMean + (denominator > 0.0 ? numerator / denominator : 0.0);
+        // Limitar predicción al rango válido
+        return max(minRating, min(maxRating, prediction));
+    }
+};
+
+template <typename P>
+double RecommenderSystem::predictCellWith(int user, int item, double& numerator, double& denominator,
+                                          vector<pair<int, double>>& scratch) const {
+    // En modo por ítems se predice la celda traspuesta con los vecinos del ítem
+    if (mode == ITEM_BASED) swap(user, item);
+    const UtilityMatrix& space = model();
+    numerator = 0.0;
+    denominator = 0.0;
+    
+    // Recorrer la lista ordenada acumulando los k primeros que calificaron el item
+    const Neighbor* list = neighborIndex.getList(user);
+    int length = neighborIndex.getListLength();
+    int found = 0, r = 0;
+    for (; r < length && list[r].id >= 0 && found < numNeighbors; r++) {
+        int neighbor = list[r].id;
+        if (space.isMissing(neighbor, item)) continue;
+        double neighborMean = P::usesNeighborMean ? space.getUserMean(neighbor) : 0.0;
+        numerator += P::term(list[r].similarity, space.getRating(neighbor, item), neighborMean);
+        denominator += abs(list[r].similarity);
+        found++;
+    }
+    stats.count(COUNT_NEIGHBORS, r);
+    
+    if (found < numNeighbors && needsRaterFallback()) {
+        getNeighborsFromRaters(user, item, numNeighbors, scratch);
+        numerator = 0.0;
+        denominator = 0.0;
+        found = scratch.size();
+        for (const auto& neighbor : scratch) {
+            double neighborMean = P::usesNeighborMean ? space.getUserMean(neighbor.first) : 0.0;
+            numerator += P::term(neighbor.second, space.getRating(neighbor.first, item), neighborMean);
+            denominator += abs(neighbor.second);
+        }
+    }
+    
+    if (found == 0) return space.getUserMean(user);
+    return P::finish(space.getUserMean(user), numerator, denominator, space.getMinRating(), space.getMaxRating());
+}
+
+double RecommenderSystem::predictCell(int user, int item, double& numerator, double& denominator) const {
+    // Consultas sueltas: búfer propio de cada hilo que llama, reutilizado entre consultas
+    static thread_local vector<pair<int, double>> scratch;
+    if (predictionType == SIMPLE) {
+        return predictCellWith<SimplePolicy>(user, item, numerator, denominator, scratch);
+    }
+    return predictCellWith<MeanDiffPolicy>(user, item, numerator, denominator, scratch);
+}
+
+template <typename P>
+void RecommenderSystem::predictAllWith() {
+    // Cada usuario es independiente: se reparten entre hilos. La matriz solo
+    // se lee, así que todas las predicciones usan las calificaciones observadas
+    // Búfer de vecinos por hilo para el caso de listas truncadas: sin reservas por celda
+    vector<vector<pair<int, double>>> scratch(resolveThreadCount(numThreads));
+    parallelFor(0, matrix.getNumUsers(), numThreads, 16, [&](int user, int thread) {
+        for (int64_t k = predictions.userBegin(user); k < predictions.userEnd(user); k++) {
+            double numerator, denominator;
+            double prediction = predictCellWith<P>(user, predictions.getItem(k), numerator, denominator, scratch[thread]);
+            predictions.setValue(k, prediction, numerator, denominator);
+        }
+    });
+}
+
+void RecommenderSystem::predictAll() {
+    predictions.build(matrix, numThreads);
+    if (predictionType == SIMPLE) {
+        predictAllWith<SimplePolicy>();
+    } else {
+        predictAllWith<MeanDiffPolicy>();
+    }
+    stats.count(COUNT_PREDICTIONS, predictions.size());
+}
+
+double RecommenderSystem::predict(int user, int item) const {
+    if (!matrix.isMissing(user, item)) {
+        return matrix.getRating(user, item);
+    }
+    double numerator, denominator;
+    stats.count(COUNT_PREDICTIONS, 1);
+    return predictCell(user, item, numerator, denominator);
+}
+
+vector<pair<int, double>> RecommenderSystem::topN(int user, int n) const {
+    // Predecir solo los items que el usuario no ha calificado; los candidatos
+    // van a un búfer por hilo y solo el resultado se reserva en cada consulta
+    static thread_local vector<pair<int, double>> candidates;
+    candidates.clear();
+    SparseRow row = matrix.getUserRow(user);
+    for (int item = 0, r = 0; item < matrix.getNumItems(); item++) {
+        if (r < row.size && row.index[r] == item) {
+            r++;
+            continue;
+        }
+        double numerator, denominator;
+        candidates.push_back({item, predictCell(user, item, numerator, denominator)});
+    }
+    
+    stats.count(COUNT_PREDICTIONS, candidates.size());
+    
+    // Selección parcial de los n mejores (a igualdad, el item menor)
+    size_t count = min((size_t)max(n, 0), candidates.size());
+    partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), neighborBefore);
+    return vector<pair<int, double>>(candidates.begin(), candidates.begin() + count);
+}
+
+static double percentile(vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t index = (size_t)(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+static void printLatency(const char* name, vector<double>& latencies) {
+    if (latencies.empty()) return;
+    sort(latencies.begin(), latencies.end());
+    cerr << fixed << setprecision(2) << name << ": " << latencies.size() << " consultas, p50 "
+         << percentile(latencies, 0.50) << " us, p99 " << percentile(latencies, 0.99)
+         << " us, max " << latencies.back() << " us" << endl;
+}
+
+void RecommenderSystem::serveQueries(istream& in, ostream& out) {
+    buildModel();
+    
+    // Una consulta por línea:
+    //   predict <usuario> <item>  ->  <usuario> <item> <predicción>
+    //   top <usuario> <n>         ->  <usuario> <item>:<predicción> ...
+    vector<double> predictLatency, topLatency;
+    string line;
+    char buffer[64];
+    stats.begin(STATS_QUERIES);
+    for (int lineNumber = 1; getline(in, line); lineNumber++) {
+        stringstream ss(line);
+        string command;
+        int user, value;
+        if (!(ss >> command)) continue;
+        if (!(ss >> user >> value) || user < 0 || user >= matrix.getNumUsers() ||
+            (command != "predict" && command != "top") ||
+            (command == "predict" && (value < 0 || value >= matrix.getNumItems()))) {
+            cerr << "Error: línea " << lineNumber << ": consulta no válida" << endl;
+            continue;
+        }
+        
+        auto start = chrono::steady_clock::now();
+        if (command == "predict") {
+            double prediction = predict(user, value);
+            predictLatency.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            snprintf(buffer, sizeof(buffer), "%d %d %.6f\n", user, value, prediction);
+            out << buffer;
+        } else {
+            vector<pair<int, double>> best = topN(user, value);
+            topLatency.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+            out << user;
+            for (const auto& entry : best) {
+                snprintf(buffer, sizeof(buffer), " %d:%.6f", entry.first, entry.second);
+                out << buffer;
+            }
+            out << '\n';
+        }
+    }
+    out.flush();
+    stats.end();
+    
+    printLatency("predict", predictLatency);
+    printLatency("top", topLatency);
+    if (stats.isEnabled()) stats.write(clog);
+}
+
+SweepOptions::SweepOptions() : holdout(0.1) {}
+
+const char* predictionKey(PredictionType type) {
+    return type == SIMPLE ? "simple" : "mean";
+}
+
+bool parsePrediction(const string& name, PredictionType& type) {
+    if (name == "simple") {
+        type = SIMPLE;
+    } else if (name == "mean") {
+        type = MEAN_DIFF;
+    } else {
+        cerr << "Error: Tipo de predicción no válido '" << name << "'. Use: simple o mean" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Sumas acumuladas de una lista de vecinos: la entrada r tiene las de los r
+// primeros, en el mismo orden que predictCellWith, así que la predicción con
+// cualquier k sale de una entrada y es idéntica a la de una ejecución con ese k
+struct NeighborPrefix {
+    double simple;   // numerador de SimplePolicy
+    double meanDiff; // numerador de MeanDiffPolicy
+    double weight;   // denominador común
+};
+
+static void prefixSums(const UtilityMatrix& space, int item, const vector<pair<int, double>>& neighbors,
+                       vector<NeighborPrefix>& sums) {
+    sums.resize(neighbors.size() + 1);
+    sums[0] = NeighborPrefix{0.0, 0.0, 0.0};
+    for (size_t r = 0; r < neighbors.size(); r++) {
+        int neighbor = neighbors[r].first;
+        double similarity = neighbors[r].second;
+        double rating = space.getRating(neighbor, item);
+        sums[r + 1].simple = sums[r].simple + SimplePolicy::term(similarity, rating, 0.0);
+        sums[r + 1].meanDiff = sums[r].meanDiff + MeanDiffPolicy::term(similarity, rating, space.getUserMean(neighbor));
+        sums[r + 1].weight = sums[r].weight + abs(similarity);
+    }
+}
+
+void RecommenderSystem::evaluateSweep(const vector<RatingCell>& heldOut, const SweepOptions& sweep,
+                                      vector<SweepError>& errors) const {
+    const UtilityMatrix& space = model();
+    int maxNeighbors = *max_element(sweep.neighborCounts.begin(), sweep.neighborCounts.end());
+    size_t numCounts = sweep.neighborCounts.size();
+    size_t numTypes = sweep.predictionTypes.size();
+    
+    // Las celdas se reparten entre hilos; cada hilo acumula los errores de
+    // todas las configuraciones en su copia y se suman al final
+    int threads = resolveThreadCount(numThreads);
+    vector<vector<SweepError>> partial(threads, vector<SweepError>(numCounts * numTypes, SweepError{0.0, 0.0}));
+    vector<vector<pair<int, double>>> listed(threads), fallback(threads);
+    vector<vector<NeighborPrefix>> listedSums(threads), fallbackSums(threads);
+    parallelFor(0, (int)heldOut.size(), threads, 256, [&](int c, int thread) {
+        int user = heldOut[c].user, item = heldOut[c].item;
+        if (mode == ITEM_BASED) swap(user, item);
+        
+        // Un solo recorrido de la lista hasta el mayor k: los vecinos de
+        // cualquier k menor son un prefijo de esta selección
+        vector<pair<int, double>>& found = listed[thread];
+        found.clear();
+        const Neighbor* list = neighborIndex.getList(user);
+        int length = neighborIndex.getListLength();
+        int r = 0;
+        for (; r < length && list[r].id >= 0 && (int)found.size() < maxNeighbors; r++) {
+            if (!space.isMissing(list[r].id, item)) {
+                found.push_back({list[r].id, list[r].similarity});
+            }
+        }
+        stats.count(COUNT_NEIGHBORS, r);
+        // Con listas truncadas, los k que la lista no cubre usan los mejores
+        // entre quienes calificaron el ítem, también como prefijo del mayor k
+        bool useFallback = (int)found.size() < maxNeighbors && needsRaterFallback();
+        prefixSums(space, item, found, listedSums[thread]);
+        if (useFallback) {
+            getNeighborsFromRaters(user, item, maxNeighbors, fallback[thread]);
+            prefixSums(space, item, fallback[thread], fallbackSums[thread]);
+        }
+        
+        double userMean = space.getUserMean(user);
+        for (size_t k = 0; k < numCounts; k++) {
+            int count = sweep.neighborCounts[k];
+            const vector<NeighborPrefix>& sums =
+                useFallback && (int)found.size() < count ? fallbackSums[thread] : listedSums[thread];
+            int used = min(count, (int)sums.size() - 1);
+            const NeighborPrefix& prefix = sums[used];
+            for (size_t t = 0; t < numTypes; t++) {
+                double prediction = userMean;
+                if (used > 0 && sweep.predictionTypes[t] == SIMPLE) {
+                    prediction = SimplePolicy::finish(userMean, prefix.simple, prefix.weight,
+                                                      space.getMinRating(), space.getMaxRating());
+                } else if (used > 0) {
+                    prediction = MeanDiffPolicy::finish(userMean, prefix.meanDiff, prefix.weight,
+                                                        space.getMinRating(), space.getMaxRating());
+                }
+                double error = prediction - heldOut[c].value;
+                SweepError& total = partial[thread][k * numTypes + t];
+                total.absolute += abs(error);
+                total.squared += error * error;
+            }
+        }
+    });
+    stats.count(COUNT_PREDICTIONS, (long long)heldOut.size() * numCounts * numTypes);
+    
+    errors.assign(numCounts * numTypes, SweepError{0.0, 0.0});
+    for (const vector<SweepError>& threadErrors : partial) {
+        for (size_t e = 0; e < errors.size(); e++) {
+            errors[e].absolute += threadErrors[e].absolute;
+            errors[e].squared += threadErrors[e].squared;
+        }
+    }
+}
+
+void RecommenderSystem::runSweep(const SweepOptions& sweep) {
+    // Retirar las calificaciones de prueba antes de construir ningún modelo
+    long long totalRatings = matrix.getNumRatings();
+    vector<RatingCell> heldOut;
+    matrix.holdOut(sweep.holdout, seed, heldOut);
+    if (mode == ITEM_BASED) {
+        itemMatrix.transposeFrom(matrix);
+    }
+    if (heldOut.empty()) {
+        throw runtime_error("No hay calificaciones que retener para evaluar el barrido");
+    }
+    clog << "Calificaciones retenidas: " << heldOut.size() << " de " << totalRatings
+         << " (semilla " << seed << ")" << endl;
+    
+    // Cada métrica construye sus similitudes y su índice una sola vez; todas
+    // las combinaciones de k y tipo de predicción se evalúan a partir de él
+    size_t numTypes = sweep.predictionTypes.size();
+    vector<vector<SweepError>> errors(sweep.metrics.size());
+    for (size_t m = 0; m < sweep.metrics.size(); m++) {
+        metric = sweep.metrics[m];
+        auto start = chrono::steady_clock::now();
+        buildModel();
+        auto built = chrono::steady_clock::now();
+        stats.begin(STATS_PREDICTION);
+        evaluateSweep(heldOut, sweep, errors[m]);
+        stats.end();
+        auto evaluated = chrono::steady_clock::now();
+        clog << fixed << setprecision(3) << metricKey(metric) << ": modelo en "
+             << chrono::duration<double>(built - start).count() << " s, "
+             << errors[m].size() << " configuraciones evaluadas en "
+             << chrono::duration<double>(evaluated - built).count() << " s" << endl;
+    }
+    
+    cout << "\n=== BARRIDO DE CONFIGURACIONES ===" << endl;
+    cout << "Métrica        k  Predicción        MAE       RMSE" << endl;
+    char line[128];
+    double bestRmse = 0.0;
+    string best;
+    for (size_t m = 0; m < sweep.metrics.size(); m++) {
+        for (size_t k = 0; k < sweep.neighborCounts.size(); k++) {
+            for (size_t t = 0; t < numTypes; t++) {
+                const SweepError& error = errors[m][k * numTypes + t];
+                double mae = error.absolute / heldOut.size();
+                double rmse = sqrt(error.squared / heldOut.size());
+                const char* type = predictionKey(sweep.predictionTypes[t]);
+                snprintf(line, sizeof(line), "%-10s %5d  %-10s %10.4f %10.4f",
+                         metricKey(sweep.metrics[m]), sweep.neighborCounts[k], type, mae, rmse);
+                cout << line << endl;
+                if (best.empty() || rmse < bestRmse) {
+                    bestRmse = rmse;
+                    snprintf(line, sizeof(line), "-m %s -k %d -p %s", metricKey(sweep.metrics[m]),
+                             sweep.neighborCounts[k], type);
+                    best = line;
+                }
+            }
+        }
+    }
+    cout << "Mejor configuración (RMSE): " << best << endl;
+    
+    if (stats.isEnabled()) stats.write(clog);
+}
+
+static void appendFormat(string& out, const char* format, ...) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    out.append(buffer, min(length, (int)sizeof(buffer) - 1));
+}
+
+void RecommenderSystem::appendTextReport(int user, string& out, vector<pair<int, double>>& neighbors) const {
+    appendFormat(out, "\n--- Usuario %d ---\n", user);
+    
+    for (int64_t k = predictions.userBegin(user); k < predictions.userEnd(user); k++) {
+        int item = predictions.getItem(k);
+        // Los vecinos solo se vuelven a obtener si se pide el informe detallado
+        if (mode == ITEM_BASED) {
+            getNeighbors(item, user, numNeighbors, neighbors);
+        } else {
+            getNeighbors(user, item, numNeighbors, neighbors);
+        }
+        
+        appendFormat(out, "\nPredicción para Item %d:\n", item);
+        appendFormat(out, "  Vecinos seleccionados (%d):\n", (int)neighbors.size());
+        for (const auto& neighbor : neighbors) {
+            double rating = mode == ITEM_BASED ? matrix.getRating(user, neighbor.first)
+                                               : matrix.getRating(neighbor.first, item);
+            appendFormat(out, "    %s %d (similitud: %.3f, rating: %.3f)\n",
+                         entityName(), neighbor.first, neighbor.second, rating);
+        }
+        
+        if (predictionType == SIMPLE) {
+            appendFormat(out, "  Cálculo: (%.3f) / (%.3f) = ", predictions.getNumerator(k), predictions.getDenominator(k));
+        } else if (mode == ITEM_BASED) {
+            appendFormat(out, "  Cálculo: Media item (%.3f) + ajuste = ", itemMatrix.getUserMean(item));
+        } else {
+            appendFormat(out, "  Cálculo: Media usuario (%.3f) + ajuste = ", matrix.getUserMean(user));
+        }
+        appendFormat(out, "%.3f\n", predictions.getValue(k));
+    }
+}
+
+void RecommenderSystem::appendCompactReport(int user, string& out) const {
+    for (int64_t k = predictions.userBegin(user); k < predictions.userEnd(user); k++) {
+        appendFormat(out, "%d\t%d\t%.6f\n", user, predictions.getItem(k), predictions.getValue(k));
+    }
+}
+
+void RecommenderSystem::writePredictionReport() const {
+    if (reportFormat == REPORT_NONE) return;
+    
     ofstream outFile("predictions.txt");
     if (!outFile.is_open()) {
         cerr << "Error: No se pudo abrir el archivo predictions.txt" << endl;
@@ -169,51 +1099,27 @@ void RecommenderSystem::makePredictions() {
     }
     
     cout << "Escribiendo predicciones en predictions.txt..." << endl;
+    if (reportFormat == REPORT_COMPACT) {
+        outFile << "usuario\titem\tprediccion\n";
+    }
     
-    for (int user = 0; user < matrix.getNumUsers(); user++) {
-        outFile << "\n--- Usuario " << user << " ---" << endl;
-        
-        for (int item = 0; item < matrix.getNumItems(); item++) {
-            if (matrix.isMissing(user, item)) {
-                // Obtener vecinos
-                auto neighbors = getNeighbors(user, item, numNeighbors);
-                
-                outFile << "\nPredicción para Item " << item << ":" << endl;
-                outFile << "  Vecinos seleccionados (" << neighbors.size() << "):" << endl;
-                
-                for (const auto& neighbor : neighbors) {
-                    outFile << "    Usuario " << neighbor.first 
-                         << " (similitud: " << fixed << setprecision(3) << neighbor.second 
-                         << ", rating: " << fixed << setprecision(3) << matrix.getRating(neighbor.first, item) << ")" << endl;
-                }
-                
-                // Calcular predicción
-                double prediction;
-                if (predictionType == SIMPLE) {
-                    prediction = simplePrediction(user, item, neighbors);
-                } else {
-                    prediction = meanDiffPrediction(user, item, neighbors);
-                }
-                
-                outFile << "  Cálculo: ";
-                if (predictionType == SIMPLE) {
-                    double numerator = 0.0, denominator = 0.0;
-                    for (const auto& neighbor : neighbors) {
-                        numerator += neighbor.second * matrix.getRating(neighbor.first, item);
-                        denominator += abs(neighbor.second);
-                    }
-                    outFile << "(" << fixed << setprecision(3) << numerator << ") / (" 
-                         << fixed << setprecision(3) << denominator << ") = ";
-                } else {
-                    double userMean = matrix.getUserMean(user);
-                    outFile << "Media usuario (" << fixed << setprecision(3) << userMean << ") + ajuste = ";
-                }
-                
-                outFile << fixed << setprecision(3) << prediction << endl;
-                
-                // Guardar predicción
-                matrix.setRating(user, item, prediction);
+    // El texto se genera en paralelo por bloques de usuarios y se escribe en orden
+    const int blockSize = 1024;
+    vector<string> buffers(blockSize);
+    vector<vector<pair<int, double>>> neighbors(resolveThreadCount(numThreads));
+    for (int first = 0; first < matrix.getNumUsers(); first += blockSize) {
+        int last = min(matrix.getNumUsers(), first + blockSize);
+        parallelFor(first, last, numThreads, 8, [&](int user, int thread) {
+            string& out = buffers[user - first];
+            out.clear();
+            if (reportFormat == REPORT_TEXT) {
+                appendTextReport(user, out, neighbors[thread]);
+            } else {
+                appendCompactReport(user, out);
             }
+        });
+        for (int user = first; user < last; user++) {
+            outFile.write(buffers[user - first].data(), buffers[user - first].size());
         }
     }
     
@@ -221,24 +1127,55 @@ void RecommenderSystem::makePredictions() {
     cout << "Predicciones completadas y guardadas en predictions.txt" << endl;
 }
 
+void RecommenderSystem::makePredictions() {
+    stats.begin(STATS_PREDICTION);
+    predictAll();
+    stats.end();
+    stats.begin(STATS_REPORT);
+    writePredictionReport();
+    stats.end();
+    if (reportFormat == REPORT_NONE) {
+        cout << "Predicciones completadas (" << predictions.size() << " celdas)" << endl;
+    }
+}
+
 void RecommenderSystem::generateRecommendations() {
-    for (int user = 0; user < matrix.getNumUsers(); user++) {
-        vector<pair<int, double>> recommendations;
-        
-        for (int item = 0; item < matrix.getNumItems(); item++) {
-            recommendations.push_back({item, matrix.getRating(user, item)});
+    recommendations.resize(matrix.getNumUsers(), topItems);
+    if (topItems <= 0) return;
+    
+    // Montículo acotado por hilo: la cima es el peor de los topItems mejores
+    // vistos hasta ahora, así que cada candidato cuesta O(log topItems)
+    vector<vector<pair<int, double>>> heaps(resolveThreadCount(numThreads));
+    for (auto& heap : heaps) heap.reserve(topItems);
+    parallelFor(0, matrix.getNumUsers(), numThreads, 64, [&](int user, int threadId) {
+        vector<pair<int, double>>& heap = heaps[threadId];
+        heap.clear();
+        for (int64_t k = predictions.userBegin(user); k < predictions.userEnd(user); k++) {
+            pair<int, double> candidate(predictions.getItem(k), predictions.getValue(k));
+            if ((int)heap.size() < topItems) {
+                heap.push_back(candidate);
+                push_heap(heap.begin(), heap.end(), neighborBefore);
+            } else if (neighborBefore(candidate, heap.front())) {
+                pop_heap(heap.begin(), heap.end(), neighborBefore);
+                heap.back() = candidate;
+                push_heap(heap.begin(), heap.end(), neighborBefore);
+            }
         }
-        
-        // Ordenar por rating descendente
-        sort(recommendations.begin(), recommendations.end(),
-             [](const pair<int, double>& a, const pair<int, double>& b) {
-                 return a.second > b.second;
-             });
-        
-        cout << "\nUsuario " << user << " (Top 5 items recomendados):" << endl;
-        for (size_t i = 0; i < min((size_t)5, recommendations.size()); i++) {
-            cout << "  " << (i + 1) << ". Item " << recommendations[i].first 
-                 << " (rating: " << fixed << setprecision(3) << recommendations[i].second << ")" << endl;
+        sort_heap(heap.begin(), heap.end(), neighborBefore);
+        recommendations.set(user, heap.data(), heap.size());
+    });
+}
+
+const RecommendationSet& RecommenderSystem::getRecommendations() const {
+    return recommendations;
+}
+
+void RecommenderSystem::printRecommendations() const {
+    for (int user = 0; user < recommendations.getNumUsers(); user++) {
+        cout << "\nUsuario " << user << " (Top " << topItems << " items recomendados):" << endl;
+        for (int r = 0; r < recommendations.getCount(user); r++) {
+            cout << "  " << (r + 1) << ". Item " << recommendations.getItem(user, r)
+                 << " (rating: " << fixed << setprecision(3) << recommendations.getRating(user, r) << ")" << endl;
         }
     }
 }
@@ -3,33 +3,201 @@
 
 #include "UtilityMatrix.h"
 #include "SimilarityCalculator.h"
+#include "SimilarityMatrix.h"
+#include "NeighborIndex.h"
+#include "PairSums.h"
+#include "PredictionSet.h"
+#include "RecommendationSet.h"
+#include "RunStats.h"
 #include <vector>
 #include <utility>
+#include <iostream>
 
 enum PredictionType {
     SIMPLE,
     MEAN_DIFF
 };
 
+// Nombre del tipo de predicción en la línea de órdenes ("simple" o "mean")
+const char* predictionKey(PredictionType type);
+// Tipo a partir de su nombre; si no existe, muestra el error y devuelve false
+bool parsePrediction(const string& name, PredictionType& type);
+
+// Filtrado basado en usuarios (vecinos entre usuarios) o en ítems (vecinos
+// entre ítems, calculados sobre la matriz traspuesta)
+enum FilteringMode {
+    USER_BASED,
+    ITEM_BASED
+};
+
+// Cálculo de las similitudes exactas: par a par o por paneles de usuarios
+enum SimilarityEngine {
+    ENGINE_PAIRWISE,
+    ENGINE_BLOCKED
+};
+
+// Almacenamiento de las similitudes exactas
+enum SimilarityStorage {
+    STORAGE_DOUBLE, // triángulo superior empaquetado en double
+    STORAGE_FLOAT,  // el mismo triángulo en float (mitad de memoria)
+    STORAGE_TOPK    // solo las listas de los -l mejores vecinos de cada usuario
+};
+
+// Informe de predicciones en predictions.txt
+enum ReportFormat {
+    REPORT_NONE,     // sin informe
+    REPORT_TEXT,     // detalle legible: vecinos y cálculo de cada predicción
+    REPORT_COMPACT   // una línea "usuario item predicción" por celda
+};
+
+// Cambio de una calificación; rating -1 elimina la calificación
+struct RatingUpdate {
+    int user;
+    int item;
+    double rating;
+};
+
+struct RecommenderOptions {
+    FilteringMode mode;
+    SimilarityEngine engine;
+    SimilarityStorage storage;
+    Metric metric;
+    int numNeighbors;
+    PredictionType predictionType;
+    int numThreads; // 0 = todos los núcleos
+    int neighborListLength; // por defecto 50; 0 = lista completa
+    string similarityCache; // instantánea de similitudes ("" = no usar)
+    string updatesFile; // actualizaciones a aplicar tras las similitudes
+    ReportFormat reportFormat;
+    int topItems; // recomendaciones por usuario
+    // Vecinos aproximados por LSH (0 tablas = cálculo exacto de todos los pares)
+    int lshTables;
+    int lshBits; // 0 = según el número de usuarios
+    uint64_t seed;
+    bool lshRecall; // medir el recall frente al cálculo exacto
+    bool stats; // tiempos y contadores por fase en JSON (salida de error)
+    PairFilter filter; // poda de pares y ponderación por significancia
+    
+    RecommenderOptions();
+};
+
+// Barrido de configuraciones: cada métrica se calcula una vez y todos los
+// valores de k y tipos de predicción se evalúan con su lista de vecinos,
+// midiendo el error sobre una fracción retenida de las calificaciones
+struct SweepOptions {
+    vector<Metric> metrics;
+    vector<int> neighborCounts;
+    vector<PredictionType> predictionTypes;
+    double holdout; // fracción de calificaciones retenidas para evaluar
+    
+    SweepOptions();
+};
+
+// Error acumulado de una configuración del barrido
+struct SweepError {
+    double absolute;
+    double squared;
+};
+
 class RecommenderSystem {
 private:
     UtilityMatrix matrix;
+    // Traspuesta de matrix (ítems x usuarios), solo en modo ITEM_BASED
+    UtilityMatrix itemMatrix;
+    FilteringMode mode;
+    SimilarityEngine engine;
+    SimilarityStorage storage;
     Metric metric;
     int numNeighbors;
     PredictionType predictionType;
-    vector<vector<double>> similarities;
+    int numThreads;
+    int neighborListLength;
+    string similarityCache;
+    string updatesFile;
+    ReportFormat reportFormat;
+    int topItems;
+    int lshTables;
+    int lshBits;
+    uint64_t seed;
+    bool lshRecall;
+    PairFilter filter;
+    SimilarityMatrix similarities;
+    NeighborIndex neighborIndex;
+    PairSums pairSums;
+    PredictionSet predictions;
+    RecommendationSet recommendations;
+    RunStats stats;
+    
+    // Matriz sobre la que se calculan similitudes y vecinos: matrix o, en modo
+    // por ítems, itemMatrix. Las funciones de vecinos y predicción trabajan en
+    // ese espacio: en modo por ítems, "user" es el ítem e "item" el usuario
+    const UtilityMatrix& model() const;
+    UtilityMatrix& model();
+    const char* entityName() const;
     
     void calculateAllSimilarities();
-    vector<pair<int, double>> getNeighbors(int user, int item, int k) const;
-    double simplePrediction(int user, int item, const vector<pair<int, double>>& neighbors) const;
-    double meanDiffPrediction(int user, int item, const vector<pair<int, double>>& neighbors) const;
+    void calculateTopNeighbors();
+    void calculateApproximateNeighbors();
+    // Versiones especializadas en la métrica (M = PearsonMetric, ...)
+    template <typename M> void calculateAllSimilaritiesWith();
+    template <typename M> void calculateTopNeighborsWith();
+    template <typename M> void calculateApproximateNeighborsWith();
+    void reportNeighborRecall() const;
+    SnapshotKey snapshotKey() const;
+    bool loadSimilaritySnapshot();
+    void saveSimilaritySnapshot() const;
+    void buildModel();
+    void calculatePairSums();
+    bool readUpdates(const string& filename, vector<RatingUpdate>& updates) const;
+    // Los vecinos se escriben en un búfer del llamador (uno por hilo), que
+    // conserva su capacidad entre celdas
+    void getNeighbors(int user, int item, int k, vector<pair<int, double>>& neighbors) const;
+    bool needsRaterFallback() const;
+    void getNeighborsFromRaters(int user, int item, int k, vector<pair<int, double>>& neighbors) const;
+    // Predicción de una celda y de todas, especializadas en la política de
+    // predicción (P = SimplePolicy o MeanDiffPolicy)
+    template <typename P>
+    double predictCellWith(int user, int item, double& numerator, double& denominator,
+                           vector<pair<int, double>>& scratch) const;
+    template <typename P>
+    void predictAllWith();
+    double predictCell(int user, int item, double& numerator, double& denominator) const;
+    void appendTextReport(int user, string& out, vector<pair<int, double>>& neighbors) const;
+    void appendCompactReport(int user, string& out) const;
+    // Errores de todas las combinaciones k x tipo de predicción de la métrica
+    // actual sobre las celdas retenidas, en errors[k * tipos + tipo] según el
+    // orden de las listas de sweep
+    void evaluateSweep(const vector<RatingCell>& heldOut, const SweepOptions& sweep,
+                       vector<SweepError>& errors) const;
     
 public:
-    RecommenderSystem(const string& filename, Metric m, int k, PredictionType pt);
+    RecommenderSystem(const string& filename, const RecommenderOptions& options);
     void run();
+    // Fases del modelo (buildModel las ejecuta en orden): similitudes, o su
+    // instantánea, y después las listas ordenadas de vecinos
+    void computeSimilarities();
+    void buildNeighborIndex();
     void printSimilarities() const;
+    // Devuelve el número de usuarios cuyas similitudes cambiaron
+    int applyUpdates(const vector<RatingUpdate>& updates);
+    void predictAll();
+    void writePredictionReport() const;
     void makePredictions();
+    // Selecciona en paralelo los topItems ítems no calificados con mayor
+    // predicción de cada usuario (requiere predictAll)
     void generateRecommendations();
+    const RecommendationSet& getRecommendations() const;
+    void printRecommendations() const;
+    
+    // Consultas sobre el modelo ya construido (similitudes e índice de vecinos)
+    double predict(int user, int item) const;
+    vector<pair<int, double>> topN(int user, int n) const;
+    // Construye el modelo y responde consultas línea a línea; la latencia
+    // de cada tipo de consulta (p50/p99) se resume en cerr al terminar
+    void serveQueries(istream& in, ostream& out);
+    // Retira las calificaciones de prueba y evalúa (MAE y RMSE) cada
+    // combinación de métrica, k y tipo de predicción; tabla en cout
+    void runSweep(const SweepOptions& sweep);
 };
 
 #endif
@@ -0,0 +1,117 @@
+#include "RunStats.h"
+#include <chrono>
+#include <ctime>
+#include <cstdio>
+#include <sys/resource.h>
+
+using namespace std;
+
+static const char* kPhaseNames[NUM_STATS_PHASES] = {
+    "load", "similarity", "neighbors", "updates", "prediction", "report", "recommendation", "queries"
+};
+
+static const char* kCounterNames[NUM_STATS_COUNTERS] = {
+    "pairs", "co_rated_items", "pairs_skipped", "neighbors_examined", "predictions"
+};
+
+static double wallSeconds() {
+    return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static double cpuSeconds() {
+    timespec time;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// Máximo de memoria residente del proceso hasta ahora
+static long peakRssKb() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+RunStats::RunStats() : enabled(false), current(-1), startWall(0.0), startCpu(0.0) {
+    for (int phase = 0; phase < NUM_STATS_PHASES; phase++) {
+        phases[phase].ran = false;
+    }
+    for (int counter = 0; counter < NUM_STATS_COUNTERS; counter++) {
+        counters[counter] = 0;
+    }
+}
+
+void RunStats::enable() {
+    enabled = true;
+}
+
+void RunStats::begin(StatsPhase phase) {
+    if (!enabled) return;
+    current = phase;
+    for (int counter = 0; counter < NUM_STATS_COUNTERS; counter++) {
+        counters[counter] = 0;
+    }
+    startWall = wallSeconds();
+    startCpu = cpuSeconds();
+}
+
+void RunStats::end() {
+    if (!enabled || current < 0) return;
+    PhaseStats& stats = phases[current];
+    // Una fase repetida (p. ej. varias consultas) acumula sus tiempos
+    if (!stats.ran) {
+        stats.ran = true;
+        stats.wallSeconds = 0.0;
+        stats.cpuSeconds = 0.0;
+        for (int counter = 0; counter < NUM_STATS_COUNTERS; counter++) {
+            stats.counters[counter] = 0;
+        }
+    }
+    stats.wallSeconds += wallSeconds() - startWall;
+    stats.cpuSeconds += cpuSeconds() - startCpu;
+    stats.peakRssKb = peakRssKb();
+    for (int counter = 0; counter < NUM_STATS_COUNTERS; counter++) {
+        stats.counters[counter] += counters[counter];
+    }
+    current = -1;
+}
+
+void RunStats::write(ostream& out) const {
+    PhaseStats total;
+    total.wallSeconds = 0.0;
+    total.cpuSeconds = 0.0;
+    total.peakRssKb = peakRssKb();
+    for (int counter = 0; counter < NUM_STATS_COUNTERS; counter++) {
+        total.counters[counter] = 0;
+    }
+    
+    char number[32];
+    out << "{\n  \"phases\": [";
+    bool first = true;
+    for (int phase = 0; phase < NUM_STATS_PHASES; phase++) {
+        const PhaseStats& stats = phases[phase];
+        if (!stats.ran) continue;
+        out << (first ? "\n" : ",\n") << "    {\"name\": \"" << kPhaseNames[phase] << "\"";
+        snprintf(number, sizeof(number), "%.6f", stats.wallSeconds);
+        out << ", \"wall_s\": " << number;
+        snprintf(number, sizeof(number), "%.6f", stats.cpuSeconds);
+        out << ", \"cpu_s\": " << number << ", \"peak_rss_kb\": " << stats.peakRssKb;
+        for (int counter = 0; counter < NUM_STATS_COUNTERS; counter++) {
+            out << ", \"" << kCounterNames[counter] << "\": " << stats.counters[counter];
+            total.counters[counter] += stats.counters[counter];
+        }
+        out << "}";
+        total.wallSeconds += stats.wallSeconds;
+        total.cpuSeconds += stats.cpuSeconds;
+        first = false;
+    }
+    
+    out << "\n  ],\n  \"total\": {";
+    snprintf(number, sizeof(number), "%.6f", total.wallSeconds);
+    out << "\"wall_s\": " << number;
+    snprintf(number, sizeof(number), "%.6f", total.cpuSeconds);
+    out << ", \"cpu_s\": " << number << ", \"peak_rss_kb\": " << total.peakRssKb;
+    for (int counter = 0; counter < NUM_STATS_COUNTERS; counter++) {
+        out << ", \"" << kCounterNames[counter] << "\": " << total.counters[counter];
+    }
+    out << "}\n}" << endl;
+}
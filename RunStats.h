@@ -0,0 +1,66 @@
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include <atomic>
+#include <iostream>
+
+using namespace std;
+
+// Fases del proceso con tiempos y contadores propios
+enum StatsPhase {
+    STATS_LOAD,
+    STATS_SIMILARITY,
+    STATS_NEIGHBORS,
+    STATS_UPDATES,
+    STATS_PREDICTION,
+    STATS_REPORT,
+    STATS_RECOMMENDATION,
+    STATS_QUERIES,
+    NUM_STATS_PHASES
+};
+
+// Trabajo contado dentro de cada fase
+enum StatsCounter {
+    COUNT_PAIRS,        // pares de usuarios cuya similitud se calculó
+    COUNT_CO_RATED,     // ítems co-calificados recorridos al calcular sus sumas
+    COUNT_SKIPPED,      // pares descartados sin calcular las sumas
+    COUNT_NEIGHBORS,    // entradas de listas de vecinos examinadas
+    COUNT_PREDICTIONS,  // celdas predichas
+    NUM_STATS_COUNTERS
+};
+
+// Instrumentación de --stats: tiempo real y de CPU, memoria máxima (RSS) y
+// contadores por fase. Desactivada, count() es una comprobación de un bool
+// y begin/end no hacen nada
+class RunStats {
+private:
+    struct PhaseStats {
+        bool ran;
+        double wallSeconds;
+        double cpuSeconds;
+        long peakRssKb;
+        long long counters[NUM_STATS_COUNTERS];
+    };
+    
+    bool enabled;
+    int current;
+    double startWall;
+    double startCpu;
+    PhaseStats phases[NUM_STATS_PHASES];
+    // Contadores de la fase en curso; se suman desde varios hilos
+    mutable atomic<long long> counters[NUM_STATS_COUNTERS];
+    
+public:
+    RunStats();
+    void enable();
+    bool isEnabled() const { return enabled; }
+    void begin(StatsPhase phase);
+    void end();
+    void count(StatsCounter counter, long long amount) const {
+        if (enabled) counters[counter].fetch_add(amount, memory_order_relaxed);
+    }
+    // Fases ejecutadas y totales, en JSON
+    void write(ostream& out) const;
+};
+
+#endif
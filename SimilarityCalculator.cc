@@ -1,95 +1,95 @@
 #include "SimilarityCalculator.h"
-#include <cmath>
-#include <vector>
+#include <iostream>
 
 using namespace std;
 
-SimilarityCalculator::SimilarityCalculator(const UtilityMatrix& m, Metric met) 
-    : matrix(m), metric(met) {}
-
-double SimilarityCalculator::pearsonCorrelation(int user1, int user2) const {
-    vector<double> x, y;
-    
-    // Recopilar items calificados por ambos usuarios
-    for (int i = 0; i < matrix.getNumItems(); i++) {
-        if (!matrix.isMissing(user1, i) && !matrix.isMissing(user2, i)) {
-            x.push_back(matrix.getRating(user1, i));
-            y.push_back(matrix.getRating(user2, i));
-        }
-    }
-    
-    if (x.size() < 2) return 0.0;
-    
-    // Calcular medias
-    double meanX = 0.0, meanY = 0.0;
-    for (size_t i = 0; i < x.size(); i++) {
-        meanX += x[i];
-        meanY += y[i];
+const char* metricKey(Metric metric) {
+    switch (metric) {
+        case PEARSON: return "pearson";
+        case COSINE: return "cosine";
+        case EUCLIDEAN: return "euclidean";
+        case JACCARD: return "jaccard";
     }
-    meanX /= x.size();
-    meanY /= y.size();
-    
-    // Calcular correlación
-    double numerator = 0.0, denomX = 0.0, denomY = 0.0;
-    for (size_t i = 0; i < x.size(); i++) {
-        double dx = x[i] - meanX;
-        double dy = y[i] - meanY;
-        numerator += dx * dy;
-        denomX += dx * dx;
-        denomY += dy * dy;
+    return "";
+}
+
+bool parseMetric(const string& name, Metric& metric) {
+    if (name == "pearson") {
+        metric = PEARSON;
+    } else if (name == "cosine") {
+        metric = COSINE;
+    } else if (name == "euclidean") {
+        metric = EUCLIDEAN;
+    } else if (name == "jaccard") {
+        metric = JACCARD;
+    } else {
+        cerr << "Error: Métrica no válida '" << name << "'. Use: pearson, cosine, euclidean o jaccard" << endl;
+        return false;
     }
-    
-    double denominator = sqrt(denomX * denomY);
-    return denominator > 0.0 ? numerator / denominator : 0.0;
+    return true;
 }
 
-double SimilarityCalculator::cosineSimilarity(int user1, int user2) const {
-    double dotProduct = 0.0, norm1 = 0.0, norm2 = 0.0;
-    int commonItems = 0;
-    
-    for (int i = 0; i < matrix.getNumItems(); i++) {
-        if (!matrix.isMissing(user1, i) && !matrix.isMissing(user2, i)) {
-            double r1 = matrix.getRating(user1, i);
-            double r2 = matrix.getRating(user2, i);
-            dotProduct += r1 * r2;
-            norm1 += r1 * r1;
-            norm2 += r2 * r2;
-            commonItems++;
-        }
+PairFilter::PairFilter()
+    : minOverlap(0), minSimilarity(-numeric_limits<double>::infinity()), significance(0) {}
+
+bool PairFilter::prunes() const {
+    return minOverlap > 0 || minSimilarity > -numeric_limits<double>::infinity();
+}
+
+SimilarityCalculator::SimilarityCalculator(const UtilityMatrix& m, Metric met, const PairFilter& pairFilter)
+    : matrix(m), metric(met), filter(pairFilter), kernel(selectCoRatedKernel()) {}
+
+void SimilarityCalculator::coRatedSums(int user1, int user2, CoRatedSums& sums) const {
+    // Con vista densa: una pasada enmascarada vectorizada; con máscaras, los
+    // ítems comunes por AND y popcount si las filas tienen más elementos que
+    // palabras la máscara; si no, cruce de listas
+    if (matrix.hasDenseView()) {
+        kernel(matrix.getDenseRow(user1), matrix.getDenseRow(user2),
+               matrix.getRatedMask(user1), matrix.getRatedMask(user2),
+               matrix.getMaskWords(), sums);
+    } else if (prefersMasks(user1, user2)) {
+        coRatedSumsMasked(matrix.getUserRow(user1), matrix.getUserRow(user2),
+                          matrix.getRatedMask(user1), matrix.getRatedMask(user2),
+                          matrix.getMaskWords(), sums);
+    } else {
+        coRatedSumsSparse(matrix.getUserRow(user1), matrix.getUserRow(user2), sums);
     }
-    
-    if (commonItems == 0) return 0.0;
-    
-    double denominator = sqrt(norm1 * norm2);
-    return denominator > 0.0 ? dotProduct / denominator : 0.0;
 }
 
-double SimilarityCalculator::euclideanSimilarity(int user1, int user2) const {
-    double sumSquares = 0.0;
-    int commonItems = 0;
-    
-    for (int i = 0; i < matrix.getNumItems(); i++) {
-        if (!matrix.isMissing(user1, i) && !matrix.isMissing(user2, i)) {
-            double diff = matrix.getRating(user1, i) - matrix.getRating(user2, i);
-            sumSquares += diff * diff;
-            commonItems++;
-        }
+bool SimilarityCalculator::prefersMasks(int user1, int user2) const {
+    return matrix.hasRatedMasks() &&
+           matrix.getMaskWords() <= matrix.getUserStats(user1).count + matrix.getUserStats(user2).count;
+}
+
+double similarityFromSums(Metric metric, const PairFilter& filter, const CoRatedSums& sums, int countX, int countY) {
+    switch (metric) {
+        case PEARSON:
+            return filter.fromSums<PearsonMetric>(sums, countX, countY);
+        case COSINE:
+            return filter.fromSums<CosineMetric>(sums, countX, countY);
+        case EUCLIDEAN:
+            return filter.fromSums<EuclideanMetric>(sums, countX, countY);
+        case JACCARD:
+            return filter.fromSums<JaccardMetric>(sums, countX, countY);
+        default:
+            return 0.0;
     }
-    
-    if (commonItems == 0) return 0.0;
-    
-    double distance = sqrt(sumSquares);
-    return 1.0 / (1.0 + distance); // Convertir distancia a similitud
+}
+
+double SimilarityCalculator::similarityFromSums(int user1, int user2, const CoRatedSums& sums) const {
+    return ::similarityFromSums(metric, filter, sums, matrix.getUserStats(user1).count, matrix.getUserStats(user2).count);
 }
 
 double SimilarityCalculator::calculateSimilarity(int user1, int user2) const {
     switch (metric) {
         case PEARSON:
-            return pearsonCorrelation(user1, user2);
+            return similarity<PearsonMetric>(user1, user2);
         case COSINE:
-            return cosineSimilarity(user1, user2);
+            return similarity<CosineMetric>(user1, user2);
         case EUCLIDEAN:
-            return euclideanSimilarity(user1, user2);
+            return similarity<EuclideanMetric>(user1, user2);
+        case JACCARD:
+            return similarity<JaccardMetric>(user1, user2);
         default:
             return 0.0;
     }
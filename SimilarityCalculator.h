@@ -2,24 +2,139 @@
 #define SIMILARITY_CALCULATOR_H
 
 #include "UtilityMatrix.h"
+#include "SimilarityKernels.h"
+#include <algorithm>
+#include <limits>
+
+using namespace std;
 
 enum Metric {
     PEARSON,
     COSINE,
-    EUCLIDEAN
+    EUCLIDEAN,
+    JACCARD
 };
 
+// Nombre de la métrica en la línea de órdenes ("pearson", "cosine", ...)
+const char* metricKey(Metric metric);
+// Métrica a partir de su nombre; si no existe, muestra el error y devuelve false
+bool parseMetric(const string& name, Metric& metric);
+
+// Políticas de métrica para especializar los bucles en tiempo de
+// compilación: mínimo de ítems comunes para que haya similitud, cálculo a
+// partir de las sumas y del número de calificaciones de cada usuario, y
+// mayor similitud posible conociendo solo el número de ítems comunes
+struct PearsonMetric {
+    static const int minCommon = 2;
+    static double fromSums(const CoRatedSums& s, int, int) { return pearsonFromSums(s); }
+    static double upperBound(int, int, int) { return 1.0; }
+};
+
+struct CosineMetric {
+    static const int minCommon = 1;
+    static double fromSums(const CoRatedSums& s, int, int) { return cosineFromSums(s); }
+    static double upperBound(int, int, int) { return 1.0; }
+};
+
+struct EuclideanMetric {
+    static const int minCommon = 1;
+    static double fromSums(const CoRatedSums& s, int, int) { return euclideanFromSums(s); }
+    static double upperBound(int, int, int) { return 1.0; }
+};
+
+struct JaccardMetric {
+    static const int minCommon = 1;
+    static double fromSums(const CoRatedSums& s, int countX, int countY) { return jaccardFromSums(s, countX, countY); }
+    // Con Jaccard la cuenta basta para conocer la similitud exacta
+    static double upperBound(int count, int countX, int countY) {
+        return count > 0 ? (double)count / (countX + countY - count) : 0.0;
+    }
+};
+
+// Poda de pares antes de formar las listas de vecinos. Los pares podados
+// tienen similitud 0 y, si la poda está activa, no entran en las listas
+struct PairFilter {
+    int minOverlap;       // ítems comunes mínimos (0 = el mínimo de la métrica)
+    double minSimilarity; // similitud mínima (-infinito = sin umbral)
+    // Ponderación por significancia: con n ítems comunes la similitud se
+    // multiplica por min(n, significance) / significance (0 = sin ponderar)
+    int significance;
+    
+    PairFilter();
+    bool prunes() const;
+    
+    double weight(int count) const {
+        return significance > 0 && count < significance ? (double)count / significance : 1.0;
+    }
+    template <typename M>
+    int minCommon() const {
+        return max(M::minCommon, minOverlap);
+    }
+    // Descarta el par conociendo solo el número de ítems comunes: no llega al
+    // mínimo o ni con la mayor similitud posible alcanzaría el umbral
+    template <typename M>
+    bool rejectsOverlap(int count, int countX, int countY) const {
+        return count < minCommon<M>() || M::upperBound(count, countX, countY) * weight(count) < minSimilarity;
+    }
+    template <typename M>
+    double fromSums(const CoRatedSums& s, int countX, int countY) const {
+        if (rejectsOverlap<M>(s.count, countX, countY)) return 0.0;
+        double similarity = M::fromSums(s, countX, countY) * weight(s.count);
+        return similarity < minSimilarity ? 0.0 : similarity;
+    }
+};
+
+// Similitud de la métrica a partir de las sumas co-calificadas y del número
+// de calificaciones de cada usuario, con la poda del filtro
+double similarityFromSums(Metric metric, const PairFilter& filter, const CoRatedSums& sums, int countX, int countY);
+
 class SimilarityCalculator {
 private:
     const UtilityMatrix& matrix;
     Metric metric;
+    PairFilter filter;
+    CoRatedKernel kernel;
     
-    double pearsonCorrelation(int user1, int user2) const;
-    double cosineSimilarity(int user1, int user2) const;
-    double euclideanSimilarity(int user1, int user2) const;
+    // Con máscaras y sin vista densa: recorrer las palabras de la máscara
+    // cuesta menos que cruzar las listas si estas son más largas
+    bool prefersMasks(int user1, int user2) const;
     
 public:
-    SimilarityCalculator(const UtilityMatrix& m, Metric met);
+    SimilarityCalculator(const UtilityMatrix& m, Metric met, const PairFilter& pairFilter = PairFilter());
+    void coRatedSums(int user1, int user2, CoRatedSums& sums) const;
+    
+    // Versiones especializadas para los bucles sobre muchos pares: la métrica
+    // se elige una vez fuera del bucle. Si se pasa coRated, recibe los ítems
+    // comunes recorridos al calcular las sumas, o -1 si el par se descartó antes
+    template <typename M>
+    double similarity(int user1, int user2, int* coRated = nullptr) const {
+        if (coRated) *coRated = -1;
+        // Con las cuentas en caché se descartan sin recorrer las filas los
+        // pares que no pueden tener suficientes ítems comunes
+        int count1 = matrix.getUserStats(user1).count, count2 = matrix.getUserStats(user2).count;
+        int minCommon = filter.minCommon<M>();
+        if (count1 < minCommon || count2 < minCommon) return 0.0;
+        // El solapamiento sale de las máscaras antes de calcular las sumas: se
+        // descartan aquí los pares sin ítems comunes suficientes y, con poda,
+        // la mayoría. Sin poda, con la vista densa no compensa (el kernel
+        // denso ya salta las palabras sin bits comunes), ni con filas más
+        // cortas que la máscara
+        if (matrix.hasRatedMasks() && (filter.prunes() || (!matrix.hasDenseView() && prefersMasks(user1, user2)))) {
+            int overlap = maskOverlap(matrix.getRatedMask(user1), matrix.getRatedMask(user2), matrix.getMaskWords());
+            if (filter.rejectsOverlap<M>(overlap, count1, count2)) return 0.0;
+        }
+        CoRatedSums sums;
+        coRatedSums(user1, user2, sums);
+        if (coRated) *coRated = sums.count;
+        return filter.fromSums<M>(sums, count1, count2);
+    }
+    template <typename M>
+    double similarityFromSums(int user1, int user2, const CoRatedSums& sums) const {
+        return filter.fromSums<M>(sums, matrix.getUserStats(user1).count, matrix.getUserStats(user2).count);
+    }
+    
+    // Con la métrica elegida en tiempo de ejecución, para llamadas sueltas
+    double similarityFromSums(int user1, int user2, const CoRatedSums& sums) const;
     double calculateSimilarity(int user1, int user2) const;
 };
 
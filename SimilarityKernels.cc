@@ -0,0 +1,283 @@
+#include "SimilarityKernels.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMILARITY_KERNELS_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+static void clearSums(CoRatedSums& out) {
+    out.count = 0;
+    out.sumX = out.sumY = 0.0;
+    out.sumXX = out.sumYY = out.sumXY = 0.0;
+    out.sumDiff2 = 0.0;
+}
+
+void coRatedSumsScalar(const float* x, const float* y,
+                       const uint64_t* maskX, const uint64_t* maskY,
+                       int words, CoRatedSums& out) {
+    clearSums(out);
+    for (int w = 0; w < words; w++) {
+        // Recorrer solo los bits comunes de la palabra
+        uint64_t common = maskX[w] & maskY[w];
+        while (common) {
+            int i = w * 64 + __builtin_ctzll(common);
+            double r1 = x[i];
+            double r2 = y[i];
+            double diff = r1 - r2;
+            out.sumX += r1;
+            out.sumY += r2;
+            out.sumXX += r1 * r1;
+            out.sumYY += r2 * r2;
+            out.sumXY += r1 * r2;
+            out.sumDiff2 += diff * diff;
+            out.count++;
+            common &= common - 1;
+        }
+    }
+}
+
+void coRatedSumsMasked(const SparseRow& a, const SparseRow& b,
+                       const uint64_t* maskX, const uint64_t* maskY,
+                       int words, CoRatedSums& out) {
+    clearSums(out);
+    // Posición en cada fila del primer ítem de la palabra actual
+    int rankX = 0, rankY = 0;
+    for (int w = 0; w < words; w++) {
+        uint64_t common = maskX[w] & maskY[w];
+        while (common) {
+            uint64_t below = (common & (~common + 1)) - 1;
+            double r1 = a.value[rankX + __builtin_popcountll(maskX[w] & below)];
+            double r2 = b.value[rankY + __builtin_popcountll(maskY[w] & below)];
+            double diff = r1 - r2;
+            out.sumX += r1;
+            out.sumY += r2;
+            out.sumXX += r1 * r1;
+            out.sumYY += r2 * r2;
+            out.sumXY += r1 * r2;
+            out.sumDiff2 += diff * diff;
+            out.count++;
+            common &= common - 1;
+        }
+        rankX += __builtin_popcountll(maskX[w]);
+        rankY += __builtin_popcountll(maskY[w]);
+    }
+}
+
+int maskOverlap(const uint64_t* maskX, const uint64_t* maskY, int words) {
+    int count = 0;
+    for (int w = 0; w < words; w++) {
+        count += __builtin_popcountll(maskX[w] & maskY[w]);
+    }
+    return count;
+}
+
+void coRatedSumsSparse(const SparseRow& a, const SparseRow& b, CoRatedSums& out) {
+    clearSums(out);
+    for (int p = 0, q = 0; p < a.size && q < b.size; ) {
+        if (a.index[p] < b.index[q]) {
+            p++;
+        } else if (a.index[p] > b.index[q]) {
+            q++;
+        } else {
+            double r1 = a.value[p++];
+            double r2 = b.value[q++];
+            double diff = r1 - r2;
+            out.sumX += r1;
+            out.sumY += r2;
+            out.sumXX += r1 * r1;
+            out.sumYY += r2 * r2;
+            out.sumXY += r1 * r2;
+            out.sumDiff2 += diff * diff;
+            out.count++;
+        }
+    }
+}
+
+#ifdef SIMILARITY_KERNELS_X86
+
+__attribute__((target("avx2")))
+static inline double horizontalSum(__m256d v) {
+    __m128d lo = _mm256_castpd256_pd128(v);
+    __m128d hi = _mm256_extractf128_pd(v, 1);
+    lo = _mm_add_pd(lo, hi);
+    return _mm_cvtsd_f64(_mm_add_sd(lo, _mm_unpackhi_pd(lo, lo)));
+}
+
+__attribute__((target("avx2,fma")))
+static void accumulateAvx2(__m128 x4, __m128 y4, __m256d& sx, __m256d& sy, __m256d& sxx,
+                           __m256d& syy, __m256d& sxy, __m256d& sdd) {
+    __m256d x = _mm256_cvtps_pd(x4);
+    __m256d y = _mm256_cvtps_pd(y4);
+    __m256d d = _mm256_sub_pd(x, y);
+    sx = _mm256_add_pd(sx, x);
+    sy = _mm256_add_pd(sy, y);
+    sxx = _mm256_fmadd_pd(x, x, sxx);
+    syy = _mm256_fmadd_pd(y, y, syy);
+    sxy = _mm256_fmadd_pd(x, y, sxy);
+    sdd = _mm256_fmadd_pd(d, d, sdd);
+}
+
+__attribute__((target("avx2,fma")))
+static void coRatedSumsAvx2(const float* x, const float* y,
+                            const uint64_t* maskX, const uint64_t* maskY,
+                            int words, CoRatedSums& out) {
+    const __m256i lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    __m256d sx = _mm256_setzero_pd(), sy = _mm256_setzero_pd();
+    __m256d sxx = _mm256_setzero_pd(), syy = _mm256_setzero_pd();
+    __m256d sxy = _mm256_setzero_pd(), sdd = _mm256_setzero_pd();
+    int count = 0;
+    
+    for (int w = 0; w < words; w++) {
+        uint64_t common = maskX[w] & maskY[w];
+        if (!common) continue;
+        count += __builtin_popcountll(common);
+        for (int c = 0; c < 8; c++) {
+            int bits = (int)((common >> (8 * c)) & 0xff);
+            if (!bits) continue;
+            // Expandir los 8 bits a una máscara por carril y anular los huecos
+            __m256 mask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(
+                _mm256_and_si256(_mm256_set1_epi32(bits), lanes), lanes));
+            const float* px = x + w * 64 + c * 8;
+            const float* py = y + w * 64 + c * 8;
+            __m256 xv = _mm256_and_ps(_mm256_loadu_ps(px), mask);
+            __m256 yv = _mm256_and_ps(_mm256_loadu_ps(py), mask);
+            accumulateAvx2(_mm256_castps256_ps128(xv), _mm256_castps256_ps128(yv),
+                           sx, sy, sxx, syy, sxy, sdd);
+            accumulateAvx2(_mm256_extractf128_ps(xv, 1), _mm256_extractf128_ps(yv, 1),
+                           sx, sy, sxx, syy, sxy, sdd);
+        }
+    }
+    
+    out.count = count;
+    out.sumX = horizontalSum(sx);
+    out.sumY = horizontalSum(sy);
+    out.sumXX = horizontalSum(sxx);
+    out.sumYY = horizontalSum(syy);
+    out.sumXY = horizontalSum(sxy);
+    out.sumDiff2 = horizontalSum(sdd);
+}
+
+__attribute__((target("avx512f")))
+static double reduceAvx512(__m512d v) {
+    double lanes[8];
+    _mm512_storeu_pd(lanes, v);
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+__attribute__((target("avx512f")))
+static void coRatedSumsAvx512(const float* x, const float* y,
+                              const uint64_t* maskX, const uint64_t* maskY,
+                              int words, CoRatedSums& out) {
+    __m512d sx = _mm512_setzero_pd(), sy = _mm512_setzero_pd();
+    __m512d sxx = _mm512_setzero_pd(), syy = _mm512_setzero_pd();
+    __m512d sxy = _mm512_setzero_pd(), sdd = _mm512_setzero_pd();
+    int count = 0;
+    
+    for (int w = 0; w < words; w++) {
+        uint64_t common = maskX[w] & maskY[w];
+        if (!common) continue;
+        count += __builtin_popcountll(common);
+        for (int c = 0; c < 8; c++) {
+            __mmask8 k = (__mmask8)(common >> (8 * c));
+            if (!k) continue;
+            const float* px = x + w * 64 + c * 8;
+            const float* py = y + w * 64 + c * 8;
+            __m512d xv = _mm512_maskz_cvtps_pd(k, _mm256_loadu_ps(px));
+            __m512d yv = _mm512_maskz_cvtps_pd(k, _mm256_loadu_ps(py));
+            __m512d d = _mm512_sub_pd(xv, yv);
+            sx = _mm512_add_pd(sx, xv);
+            sy = _mm512_add_pd(sy, yv);
+            sxx = _mm512_fmadd_pd(xv, xv, sxx);
+            syy = _mm512_fmadd_pd(yv, yv, syy);
+            sxy = _mm512_fmadd_pd(xv, yv, sxy);
+            sdd = _mm512_fmadd_pd(d, d, sdd);
+        }
+    }
+    
+    out.count = count;
+    out.sumX = reduceAvx512(sx);
+    out.sumY = reduceAvx512(sy);
+    out.sumXX = reduceAvx512(sxx);
+    out.sumYY = reduceAvx512(syy);
+    out.sumXY = reduceAvx512(sxy);
+    out.sumDiff2 = reduceAvx512(sdd);
+}
+
+#endif
+
+static const char* kernelName = "scalar";
+
+static CoRatedKernel detectKernel() {
+    const char* forced = getenv("RECOMMENDER_KERNEL");
+#ifdef SIMILARITY_KERNELS_X86
+    __builtin_cpu_init();
+    bool avx512 = __builtin_cpu_supports("avx512f");
+    bool avx2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    if (forced && strcmp(forced, "scalar") == 0) {
+        avx512 = avx2 = false;
+    } else if (forced && strcmp(forced, "avx2") == 0) {
+        avx512 = false;
+    }
+    if (avx512) {
+        kernelName = "avx512";
+        return coRatedSumsAvx512;
+    }
+    if (avx2) {
+        kernelName = "avx2";
+        return coRatedSumsAvx2;
+    }
+#else
+    (void)forced;
+#endif
+    kernelName = "scalar";
+    return coRatedSumsScalar;
+}
+
+CoRatedKernel selectCoRatedKernel() {
+    static const CoRatedKernel kernel = detectKernel();
+    return kernel;
+}
+
+const char* coRatedKernelName() {
+    selectCoRatedKernel();
+    return kernelName;
+}
+
+double pearsonFromSums(const CoRatedSums& s) {
+    if (s.count < 2) return 0.0;
+    
+    double n = s.count;
+    double numerator = s.sumXY - s.sumX * s.sumY / n;
+    double denomX = s.sumXX - s.sumX * s.sumX / n;
+    double denomY = s.sumYY - s.sumY * s.sumY / n;
+    
+    // Varianza nula salvo error de redondeo: igual que en dos pasadas, sin correlación
+    if (denomX <= 1e-12 * s.sumXX || denomY <= 1e-12 * s.sumYY) return 0.0;
+    
+    double denominator = sqrt(denomX * denomY);
+    return denominator > 0.0 ? numerator / denominator : 0.0;
+}
+
+double cosineFromSums(const CoRatedSums& s) {
+    if (s.count == 0) return 0.0;
+    
+    double denominator = sqrt(s.sumXX * s.sumYY);
+    return denominator > 0.0 ? s.sumXY / denominator : 0.0;
+}
+
+double euclideanFromSums(const CoRatedSums& s) {
+    if (s.count == 0) return 0.0;
+    
+    double distance = sqrt(s.sumDiff2);
+    return 1.0 / (1.0 + distance); // Convertir distancia a similitud
+}
+
+double jaccardFromSums(const CoRatedSums& s, int countX, int countY) {
+    if (s.count == 0) return 0.0;
+    return (double)s.count / (countX + countY - s.count);
+}
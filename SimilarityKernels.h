@@ -0,0 +1,54 @@
+#ifndef SIMILARITY_KERNELS_H
+#define SIMILARITY_KERNELS_H
+
+#include "UtilityMatrix.h"
+#include <stdint.h>
+
+// Sumas sobre los items calificados por ambos usuarios. Las métricas se
+// obtienen a partir de ellas sin volver a recorrer las filas
+struct CoRatedSums {
+    int count;
+    double sumX;
+    double sumY;
+    double sumXX;
+    double sumYY;
+    double sumXY;
+    double sumDiff2;
+};
+
+// Kernel sobre filas densas (0 en huecos) y máscaras de validez de 64 bits
+typedef void (*CoRatedKernel)(const float* x, const float* y,
+                              const uint64_t* maskX, const uint64_t* maskY,
+                              int words, CoRatedSums& out);
+
+// Kernel elegido una sola vez según la CPU (AVX-512, AVX2 o escalar).
+// La variable de entorno RECOMMENDER_KERNEL=scalar|avx2|avx512 lo fuerza
+CoRatedKernel selectCoRatedKernel();
+const char* coRatedKernelName();
+
+void coRatedSumsScalar(const float* x, const float* y,
+                       const uint64_t* maskX, const uint64_t* maskY,
+                       int words, CoRatedSums& out);
+void coRatedSumsSparse(const SparseRow& a, const SparseRow& b, CoRatedSums& out);
+
+// Filas dispersas con sus máscaras de bits: los ítems comunes salen del AND
+// de las máscaras y la posición de cada valor en la fila, del número de bits
+// anteriores (popcount), sin comparar índices elemento a elemento
+void coRatedSumsMasked(const SparseRow& a, const SparseRow& b,
+                       const uint64_t* maskX, const uint64_t* maskY,
+                       int words, CoRatedSums& out);
+
+// Número de ítems comunes a partir de las máscaras, sin leer los valores
+int maskOverlap(const uint64_t* maskX, const uint64_t* maskY, int words);
+
+// Métricas a partir de las sumas. Difieren del cálculo en dos pasadas
+// (medias y luego desviaciones) solo por redondeo; en Pearson el error crece
+// con media² / varianza de las filas. benchmark --check lo mide
+double pearsonFromSums(const CoRatedSums& s);
+double cosineFromSums(const CoRatedSums& s);
+double euclideanFromSums(const CoRatedSums& s);
+// Jaccard sobre los conjuntos de ítems calificados: necesita además cuántos
+// ítems calificó cada usuario
+double jaccardFromSums(const CoRatedSums& s, int countX, int countY);
+
+#endif
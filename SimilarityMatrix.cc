@@ -0,0 +1,181 @@
+#include "SimilarityMatrix.h"
+#include "MappedFile.h"
+#include "ContentHash.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+using namespace std;
+
+// Cabecera de las instantáneas; los valores siguen alineados a 64 bytes
+static const char kSnapshotMagic[8] = {'S', 'I', 'M', 'S', 'N', 'A', 'P', '\0'};
+static const uint32_t kSnapshotVersion = 3;
+static const uint32_t kByteOrderMark = 0x01020304;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t metric;
+    int32_t numUsers;
+    int32_t valueBytes;
+    int32_t minOverlap;
+    int32_t significance;
+    int32_t reserved;
+    double minSimilarity;
+    uint64_t matrixHash;
+    uint64_t payloadOffset;
+    uint64_t payloadSize;
+    uint64_t checksum;
+};
+
+SimilarityMatrix::SimilarityMatrix()
+    : numUsers(0), singlePrecision(false), data(nullptr), compactData(nullptr) {}
+
+size_t SimilarityMatrix::index(int i, int j) const {
+    // Fila i del triángulo superior: empieza tras las filas 0..i-1
+    size_t row = (size_t)i;
+    return row * (2 * (size_t)numUsers - row - 1) / 2 + (size_t)(j - i - 1);
+}
+
+size_t SimilarityMatrix::numPairs() const {
+    return numUsers > 1 ? (size_t)numUsers * (numUsers - 1) / 2 : 0;
+}
+
+void SimilarityMatrix::resize(int n, bool singlePrecision) {
+    mapping.reset();
+    numUsers = n;
+    this->singlePrecision = singlePrecision;
+    if (singlePrecision) {
+        vector<double>().swap(values);
+        compactValues.assign(numPairs(), 0.0f);
+        data = nullptr;
+        compactData = compactValues.data();
+    } else {
+        vector<float>().swap(compactValues);
+        values.assign(numPairs(), 0.0);
+        data = values.data();
+        compactData = nullptr;
+    }
+}
+
+int SimilarityMatrix::size() const {
+    return numUsers;
+}
+
+bool SimilarityMatrix::isSinglePrecision() const {
+    return singlePrecision;
+}
+
+size_t SimilarityMatrix::memoryBytes() const {
+    return numPairs() * (singlePrecision ? sizeof(float) : sizeof(double));
+}
+
+double SimilarityMatrix::get(int i, int j) const {
+    if (i == j) return 1.0;
+    size_t k = i < j ? index(i, j) : index(j, i);
+    return compactData ? compactData[k] : data[k];
+}
+
+void SimilarityMatrix::set(int i, int j, double value) {
+    if (i == j) return;
+    materialize();
+    size_t k = i < j ? index(i, j) : index(j, i);
+    if (singlePrecision) {
+        compactValues[k] = (float)value;
+    } else {
+        values[k] = value;
+    }
+}
+
+void SimilarityMatrix::materialize() {
+    // Copiar la instantánea a memoria propia antes de modificarla
+    if (!mapping) return;
+    if (singlePrecision) {
+        compactValues.assign(compactData, compactData + numPairs());
+        compactData = compactValues.data();
+    } else {
+        values.assign(data, data + numPairs());
+        data = values.data();
+    }
+    mapping.reset();
+}
+
+bool SimilarityMatrix::saveSnapshot(const string& filename, const SnapshotKey& key) const {
+    ofstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: No se puede crear el archivo " << filename << endl;
+        return false;
+    }
+    
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    header.version = kSnapshotVersion;
+    header.byteOrder = kByteOrderMark;
+    header.metric = key.metric;
+    header.numUsers = numUsers;
+    header.valueBytes = key.valueBytes;
+    header.matrixHash = key.matrixHash;
+    header.minOverlap = key.minOverlap;
+    header.significance = key.significance;
+    header.minSimilarity = key.minSimilarity;
+    header.payloadOffset = (sizeof(header) + 63) / 64 * 64;
+    header.payloadSize = memoryBytes();
+    const void* payload = singlePrecision ? (const void*)compactData : (const void*)data;
+    header.checksum = hashBytes(payload, header.payloadSize);
+    
+    static const char padding[64] = {0};
+    file.write((const char*)&header, sizeof(header));
+    file.write(padding, header.payloadOffset - sizeof(header));
+    file.write((const char*)payload, header.payloadSize);
+    
+    if (!file) {
+        cerr << "Error: No se pudo escribir el archivo " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+bool SimilarityMatrix::loadSnapshot(const string& filename, const SnapshotKey& key) {
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    if (!file->open(filename)) return false;
+    
+    SnapshotHeader header;
+    if (file->size() < sizeof(header)) return false;
+    memcpy(&header, file->data(), sizeof(header));
+    if (memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+        header.version != kSnapshotVersion || header.byteOrder != kByteOrderMark) {
+        return false;
+    }
+    
+    // Otra métrica, otra precisión, otra poda u otros datos: la instantánea no sirve
+    if (header.metric != key.metric || header.valueBytes != key.valueBytes ||
+        header.matrixHash != key.matrixHash || header.minOverlap != key.minOverlap ||
+        header.significance != key.significance || header.minSimilarity != key.minSimilarity ||
+        header.numUsers < 0) {
+        return false;
+    }
+    
+    uint64_t n = header.numUsers;
+    uint64_t expected = (n > 1 ? n * (n - 1) / 2 : 0) * header.valueBytes;
+    if (header.payloadSize != expected || header.payloadOffset % 64 != 0 ||
+        header.payloadOffset > file->size() || expected > file->size() - header.payloadOffset) {
+        return false;
+    }
+    
+    const char* payload = file->data() + header.payloadOffset;
+    if (hashBytes(payload, expected) != header.checksum) {
+        cerr << "Aviso: la instantánea de similitudes " << filename << " está dañada" << endl;
+        return false;
+    }
+    
+    numUsers = header.numUsers;
+    singlePrecision = header.valueBytes == sizeof(float);
+    values.clear();
+    compactValues.clear();
+    data = singlePrecision ? nullptr : (const double*)payload;
+    compactData = singlePrecision ? (const float*)payload : nullptr;
+    mapping = file;
+    return true;
+}
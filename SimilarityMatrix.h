@@ -0,0 +1,62 @@
+#ifndef SIMILARITY_MATRIX_H
+#define SIMILARITY_MATRIX_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <stdint.h>
+
+using namespace std;
+
+class MappedFile;
+
+// Identifica para qué datos es válida una instantánea de similitudes
+struct SnapshotKey {
+    int32_t metric;
+    int32_t valueBytes; // 8 (double) o 4 (float)
+    uint64_t matrixHash;
+    // Poda y ponderación con las que se calcularon los valores
+    int32_t minOverlap;
+    int32_t significance;
+    double minSimilarity;
+};
+
+// Matriz de similitudes simétrica guardada como triángulo superior empaquetado
+// (sin diagonal): n(n-1)/2 valores en un único bloque contiguo, en double o,
+// con la mitad de memoria, en float
+class SimilarityMatrix {
+private:
+    int numUsers;
+    bool singlePrecision;
+    vector<double> values;
+    vector<float> compactValues;
+    // Valores en uso: los vectores propios o una instantánea proyectada en
+    // memoria; solo uno de los dos punteros es no nulo
+    const double* data;
+    const float* compactData;
+    shared_ptr<MappedFile> mapping;
+    
+    size_t index(int i, int j) const;
+    size_t numPairs() const;
+    void materialize();
+    
+public:
+    SimilarityMatrix();
+    SimilarityMatrix(const SimilarityMatrix&) = delete;
+    SimilarityMatrix& operator=(const SimilarityMatrix&) = delete;
+    
+    void resize(int n, bool singlePrecision = false);
+    int size() const;
+    bool isSinglePrecision() const;
+    size_t memoryBytes() const;
+    double get(int i, int j) const;
+    void set(int i, int j, double value);
+    
+    // Instantáneas binarias con suma de comprobación. load devuelve false si
+    // el archivo no existe, está dañado o corresponde a otra clave
+    bool saveSnapshot(const string& filename, const SnapshotKey& key) const;
+    bool loadSnapshot(const string& filename, const SnapshotKey& key);
+};
+
+#endif
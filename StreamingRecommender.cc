@@ -0,0 +1,449 @@
+#include "StreamingRecommender.h"
+#include "BlockedPairs.h"
+#include "NeighborIndex.h"
+#include "ParallelFor.h"
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+using namespace std;
+
+// Bytes de salida reservados por celda al estimar el búfer de predicciones
+static const size_t kOutputBytesPerCell = 32;
+
+static double toMegabytes(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+void RowBlock::clear() {
+    users.clear();
+    start.assign(1, 0);
+    items.clear();
+    values.clear();
+}
+
+size_t RowBlock::bytes() const {
+    return users.size() * sizeof(int) + start.size() * sizeof(int64_t) +
+           items.size() * (sizeof(int) + sizeof(float));
+}
+
+SparseRow RowBlock::row(int local) const {
+    SparseRow r;
+    r.index = items.data() + start[local];
+    r.value = values.data() + start[local];
+    r.size = (int)(start[local + 1] - start[local]);
+    return r;
+}
+
+int RowBlock::find(int user) const {
+    auto it = lower_bound(users.begin(), users.end(), user);
+    return (it != users.end() && *it == user) ? (int)(it - users.begin()) : -1;
+}
+
+StreamingRecommender::StreamingRecommender(const string& filename, const RecommenderOptions& options,
+                                           size_t memoryBudget)
+    : filename(filename), metric(options.metric), filter(options.filter), numNeighbors(options.numNeighbors),
+      predictionType(options.predictionType), numThreads(resolveThreadCount(options.numThreads)),
+      listLength(options.neighborListLength), memoryBudget(memoryBudget), fixedBytes(0), peakBytes(0) {}
+
+bool StreamingRecommender::open() {
+    file.open(filename, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: No se puede abrir el archivo " << filename << endl;
+        return false;
+    }
+    file.seekg(0, ios::end);
+    uint64_t size = file.tellg();
+    file.seekg(0);
+    if (!file.read((char*)&header, sizeof(header)) || !isBinaryMatrix(header.magic, sizeof(header.magic))) {
+        cerr << "Error: " << filename << ": el modo fuera de memoria requiere el formato binario (use -c para convertir)" << endl;
+        return false;
+    }
+    if (!validateBinaryHeader(header, size, filename)) {
+        return false;
+    }
+
+    // Solo los desplazamientos de las filas (O(U)) se guardan completos
+    rowStart.resize((size_t)header.numUsers + 1);
+    file.seekg(header.sectionOffset[SEC_ROW_START]);
+    file.read((char*)rowStart.data(), header.sectionSize[SEC_ROW_START]);
+    if (header.flags & kHasUserStats) {
+        userStats.resize(header.numUsers);
+        file.seekg(header.sectionOffset[SEC_USER_STATS]);
+        file.read((char*)userStats.data(), header.sectionSize[SEC_USER_STATS]);
+    }
+    if (!file) {
+        cerr << "Error: " << filename << ": no se pudo leer el archivo binario" << endl;
+        return false;
+    }
+    if (!validateOffsets(rowStart.data(), header.numUsers, header.numRatings, filename)) {
+        return false;
+    }
+    for (size_t user = 0; user < userStats.size(); user++) {
+        if (userStats[user].count != rowStart[user + 1] - rowStart[user]) {
+            cerr << "Error: " << filename << ": estadísticas no válidas para el usuario " << user << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool StreamingRecommender::validateBlock(const RowBlock& block) const {
+    for (size_t local = 0; local < block.users.size(); local++) {
+        int previous = -1;
+        for (int64_t k = block.start[local]; k < block.start[local + 1]; k++) {
+            if (block.items[k] <= previous || block.items[k] >= header.numItems) {
+                cerr << "Error: " << filename << ": índices no válidos en la fila del usuario "
+                     << block.users[local] << endl;
+                return false;
+            }
+            previous = block.items[k];
+        }
+    }
+    return true;
+}
+
+size_t StreamingRecommender::rowBytes(int user) const {
+    int64_t ratings = rowStart[user + 1] - rowStart[user];
+    return sizeof(int) + sizeof(int64_t) + ratings * (sizeof(int) + sizeof(float));
+}
+
+bool StreamingRecommender::readRows(int first, int last, RowBlock& block) {
+    block.clear();
+    for (int user = first; user < last; user++) {
+        block.users.push_back(user);
+        block.start.push_back(rowStart[user + 1] - rowStart[first]);
+    }
+    int64_t count = rowStart[last] - rowStart[first];
+    block.items.resize(count);
+    block.values.resize(count);
+    file.seekg(header.sectionOffset[SEC_ROW_ITEMS] + rowStart[first] * sizeof(int));
+    file.read((char*)block.items.data(), count * sizeof(int));
+    file.seekg(header.sectionOffset[SEC_ROW_VALUES] + rowStart[first] * sizeof(float));
+    file.read((char*)block.values.data(), count * sizeof(float));
+    if (!file) {
+        cerr << "Error: " << filename << ": no se pudieron leer las filas " << first << "-" << last - 1 << endl;
+        return false;
+    }
+    return validateBlock(block);
+}
+
+bool StreamingRecommender::readUsers(const vector<int>& users, RowBlock& block) {
+    block.clear();
+    int64_t total = 0;
+    for (int user : users) {
+        total += rowStart[user + 1] - rowStart[user];
+        block.users.push_back(user);
+        block.start.push_back(total);
+    }
+    block.items.resize(total);
+    block.values.resize(total);
+
+    // Las filas consecutivas se leen de una vez
+    int64_t out = 0;
+    for (size_t k = 0; k < users.size(); ) {
+        size_t next = k + 1;
+        while (next < users.size() && users[next] == users[next - 1] + 1) next++;
+        int64_t first = rowStart[users[k]], count = rowStart[users[next - 1] + 1] - first;
+        file.seekg(header.sectionOffset[SEC_ROW_ITEMS] + first * sizeof(int));
+        file.read((char*)(block.items.data() + out), count * sizeof(int));
+        file.seekg(header.sectionOffset[SEC_ROW_VALUES] + first * sizeof(float));
+        file.read((char*)(block.values.data() + out), count * sizeof(float));
+        out += count;
+        k = next;
+    }
+    if (!file) {
+        cerr << "Error: " << filename << ": no se pudieron leer las filas de los vecinos" << endl;
+        return false;
+    }
+    return validateBlock(block);
+}
+
+void StreamingRecommender::computeUserStats(const RowBlock& block) {
+    for (size_t local = 0; local < block.users.size(); local++) {
+        SparseRow row = block.row(local);
+        UserStats& stats = userStats[block.users[local]];
+        stats.count = row.size;
+        stats.sum = 0.0;
+        stats.sumSquares = 0.0;
+        for (int r = 0; r < row.size; r++) {
+            stats.sum += row.value[r];
+            stats.sumSquares += (double)row.value[r] * row.value[r];
+        }
+        stats.mean = stats.count > 0 ? stats.sum / stats.count : 0.0;
+        stats.norm = sqrt(stats.sumSquares);
+    }
+}
+
+void StreamingRecommender::trackMemory(size_t bytes) {
+    peakBytes = max(peakBytes, fixedBytes + bytes);
+}
+
+template <typename M>
+void StreamingRecommender::crossBlocks(const RowBlock& a, const RowBlock& b, vector<double>& tile) {
+    int sizeA = a.users.size(), sizeB = b.users.size();
+    bool same = &a == &b;
+    int panelCount = (sizeB + kBlockLanes - 1) / kBlockLanes;
+    BlockKernel kernel = selectBlockKernel();
+    panels.resize(numThreads);
+
+    // Teselas de similitud: paneles de 8 usuarios de b frente a todas las filas de a
+    tile.assign((size_t)sizeA * sizeB, 0.0);
+    parallelFor(0, panelCount, numThreads, 1, [&](int p, int thread) {
+        int first = p * kBlockLanes, count = min(kBlockLanes, sizeB - first);
+        SparseRow rows[kBlockLanes];
+        int counts[kBlockLanes];
+        for (int lane = 0; lane < count; lane++) {
+            rows[lane] = b.row(first + lane);
+            counts[lane] = rows[lane].size;
+        }
+        BlockPanel& panel = panels[thread];
+        panel.pack(rows, first, count, header.numItems);
+
+        CoRatedSums sums[kBlockLanes];
+        int rowsA = same ? first + count - 1 : sizeA;
+        for (int i = 0; i < rowsA; i++) {
+            SparseRow row = a.row(i);
+            int countA = row.size;
+            kernel(row, panel, sums);
+            for (int lane = same ? max(0, i + 1 - first) : 0; lane < count; lane++) {
+                tile[(size_t)i * sizeB + first + lane] = filter.fromSums<M>(sums[lane], countA, counts[lane]);
+            }
+        }
+    });
+
+    // Cada usuario solo actualiza su propia lista: primero los de a y luego los de b
+    parallelFor(0, sizeA, numThreads, 16, [&](int i, int) {
+        for (int j = same ? i + 1 : 0; j < sizeB; j++) {
+            neighbors.offer(a.users[i], b.users[j], tile[(size_t)i * sizeB + j]);
+        }
+    });
+    parallelFor(0, sizeB, numThreads, 16, [&](int j, int) {
+        for (int i = 0; i < (same ? j : sizeA); i++) {
+            neighbors.offer(b.users[j], a.users[i], tile[(size_t)i * sizeB + j]);
+        }
+    });
+}
+
+template <typename M>
+bool StreamingRecommender::computeNeighbors() {
+    int n = header.numUsers;
+    size_t available = memoryBudget - fixedBytes;
+
+    // Dos bloques de hasta available/4 bytes y una tesela de hasta available/2
+    size_t blockBytes = available / 4;
+    int maxBlockUsers = max(1, (int)sqrt(available / 2.0 / sizeof(double)));
+    vector<int> bounds(1, 0);
+    size_t current = 0;
+    for (int user = 0; user < n; user++) {
+        size_t bytes = rowBytes(user);
+        if (bytes > blockBytes) {
+            cerr << "Error: la fila del usuario " << user << " no cabe en el presupuesto de memoria" << endl;
+            return false;
+        }
+        if (user > bounds.back() && (current + bytes > blockBytes || user - bounds.back() >= maxBlockUsers)) {
+            bounds.push_back(user);
+            current = 0;
+        }
+        current += bytes;
+    }
+    bounds.push_back(n);
+    int blocks = bounds.size() - 1;
+    cout << "Similitudes: " << blocks << " bloques de hasta " << min(maxBlockUsers, n) << " usuarios ("
+         << (size_t)blocks * (blocks + 1) / 2 << " pares de bloques)" << endl;
+
+    // Sin estadísticas en el archivo se calculan en la primera lectura de cada bloque
+    bool needStats = userStats.empty();
+    if (needStats) userStats.resize(n);
+
+    RowBlock a, b;
+    vector<double> tile;
+    for (int ba = 0; ba < blocks; ba++) {
+        if (!readRows(bounds[ba], bounds[ba + 1], a)) return false;
+        if (needStats) computeUserStats(a);
+        crossBlocks<M>(a, a, tile);
+        trackMemory(a.bytes() + tile.size() * sizeof(double));
+        for (int bb = ba + 1; bb < blocks; bb++) {
+            if (!readRows(bounds[bb], bounds[bb + 1], b)) return false;
+            crossBlocks<M>(a, b, tile);
+            trackMemory(a.bytes() + b.bytes() + tile.size() * sizeof(double));
+        }
+    }
+
+    neighbors.finishOffers(numThreads);
+    return true;
+}
+
+bool StreamingRecommender::writePredictions(const string& outputFile) {
+    int n = header.numUsers, numItems = header.numItems;
+    ofstream out(outputFile);
+    if (!out.is_open()) {
+        cerr << "Error: No se pudo abrir el archivo " << outputFile << endl;
+        return false;
+    }
+    out << "usuario\titem\tprediccion\n";
+
+    // Cada bloque debe caber con sus vecinos y su salida en el presupuesto
+    size_t available = memoryBudget - fixedBytes;
+    vector<int> bounds(1, 0);
+    size_t current = 0;
+    for (int user = 0; user < n; user++) {
+        size_t bytes = rowBytes(user) + (numItems - (rowStart[user + 1] - rowStart[user])) * kOutputBytesPerCell;
+        const Neighbor* list = neighbors.getList(user);
+        for (int r = 0; r < listLength && list[r].id >= 0; r++) {
+            bytes += rowBytes(list[r].id);
+        }
+        if (bytes > available) {
+            cerr << "Error: el usuario " << user << " y sus vecinos no caben en el presupuesto de memoria" << endl;
+            return false;
+        }
+        if (user > bounds.back() && current + bytes > available) {
+            bounds.push_back(user);
+            current = 0;
+        }
+        current += bytes;
+    }
+    bounds.push_back(n);
+    int blocks = bounds.size() - 1;
+    cout << "Predicciones: " << blocks << " bloques" << endl;
+
+    vector<vector<double>> numerators(numThreads, vector<double>(numItems, 0.0));
+    vector<vector<double>> denominators(numThreads, vector<double>(numItems, 0.0));
+    vector<vector<int>> taken(numThreads, vector<int>(numItems, 0));
+    long long cells = 0;
+    RowBlock rows;
+    // Búferes reutilizados entre bloques: conservan su capacidad
+    vector<string> buffers;
+    vector<int> users;
+    for (int block = 0; block < blocks; block++) {
+        int first = bounds[block], last = bounds[block + 1];
+
+        // Filas de los usuarios del bloque y de todos sus vecinos
+        users.clear();
+        for (int user = first; user < last; user++) {
+            users.push_back(user);
+            const Neighbor* list = neighbors.getList(user);
+            for (int r = 0; r < listLength && list[r].id >= 0; r++) {
+                users.push_back(list[r].id);
+            }
+        }
+        sort(users.begin(), users.end());
+        users.erase(unique(users.begin(), users.end()), users.end());
+        if (!readUsers(users, rows)) return false;
+
+        if ((int)buffers.size() < last - first) buffers.resize(last - first);
+        parallelFor(first, last, numThreads, 8, [&](int user, int thread) {
+            vector<double>& numerator = numerators[thread];
+            vector<double>& denominator = denominators[thread];
+            vector<int>& count = taken[thread];
+            SparseRow own = rows.row(rows.find(user));
+            // Las celdas calificadas no se predicen: se marcan como completas
+            for (int r = 0; r < own.size; r++) {
+                count[own.index[r]] = numNeighbors;
+            }
+
+            // Recorrer los vecinos en orden: cada ítem toma los k primeros que lo calificaron
+            const Neighbor* list = neighbors.getList(user);
+            for (int r = 0; r < listLength && list[r].id >= 0; r++) {
+                const Neighbor& neighbor = list[r];
+                SparseRow row = rows.row(rows.find(neighbor.id));
+                double neighborMean = userStats[neighbor.id].mean;
+                for (int q = 0; q < row.size; q++) {
+                    int item = row.index[q];
+                    if (count[item] >= numNeighbors) continue;
+                    double rating = row.value[q];
+                    if (predictionType == SIMPLE) {
+                        numerator[item] += neighbor.similarity * rating;
+                    } else {
+                        numerator[item] += neighbor.similarity * (rating - neighborMean);
+                    }
+                    denominator[item] += abs(neighbor.similarity);
+                    count[item]++;
+                }
+            }
+
+            // Mismas fórmulas que RecommenderSystem: media del usuario si no hay vecinos
+            string& text = buffers[user - first];
+            text.clear();
+            double userMean = userStats[user].mean;
+            char line[64];
+            for (int item = 0, r = 0; item < numItems; item++) {
+                bool rated = r < own.size && own.index[r] == item;
+                if (rated) {
+                    r++;
+                } else {
+                    double prediction = userMean;
+                    if (count[item] > 0) {
+                        if (predictionType == SIMPLE) {
+                            if (denominator[item] > 0.0) prediction = numerator[item] / denominator[item];
+                        } else {
+                            prediction += denominator[item] > 0.0 ? numerator[item] / denominator[item] : 0.0;
+                            prediction = max(header.minRating, min(header.maxRating, prediction));
+                        }
+                    }
+                    int length = snprintf(line, sizeof(line), "%d\t%d\t%.6f\n", user, item, prediction);
+                    text.append(line, length);
+                }
+                numerator[item] = 0.0;
+                denominator[item] = 0.0;
+                count[item] = 0;
+            }
+        });
+
+        size_t outputBytes = 0;
+        for (int b = 0; b < last - first; b++) {
+            const string& text = buffers[b];
+            out.write(text.data(), text.size());
+            outputBytes += text.size();
+            cells += count(text.begin(), text.end(), '\n');
+        }
+        trackMemory(rows.bytes() + outputBytes);
+    }
+
+    if (!out) {
+        cerr << "Error: No se pudo escribir el archivo " << outputFile << endl;
+        return false;
+    }
+    cout << "Predicciones guardadas en " << outputFile << " (" << cells << " celdas)" << endl;
+    return true;
+}
+
+bool StreamingRecommender::run() {
+    cout << "\n=== MODO FUERA DE MEMORIA ===" << endl;
+    if (!open()) return false;
+    int n = header.numUsers, numItems = header.numItems;
+    if (listLength == 0) listLength = kDefaultListLength;
+    // Sin la matriz no hay a quién recurrir si la lista no llega a k vecinos
+    // que calificaron el ítem: al menos k entradas por usuario
+    listLength = min(max(listLength, numNeighbors), max(0, n - 1));
+
+    // Memoria fija: desplazamientos, estadísticas, listas de vecinos y
+    // búferes por hilo (paneles y acumuladores de predicción)
+    fixedBytes = rowStart.size() * sizeof(int64_t) + (size_t)n * sizeof(UserStats) +
+                 (size_t)n * listLength * sizeof(Neighbor) + (size_t)n * sizeof(int) +
+                 (size_t)numThreads * numItems * (kBlockLanes * sizeof(float) + 1 + 2 * sizeof(double) + sizeof(int));
+    cout << "Usuarios: " << n << ", ítems: " << numItems << ", calificaciones: " << header.numRatings << endl;
+    cout << fixed << setprecision(1) << "Presupuesto de memoria: " << toMegabytes(memoryBudget)
+         << " MB (fijo: " << toMegabytes(fixedBytes) << " MB, " << listLength << " vecinos por usuario)" << endl;
+    if (fixedBytes >= memoryBudget) {
+        cerr << "Error: el presupuesto de memoria es insuficiente; se necesitan más de "
+             << fixed << setprecision(1) << toMegabytes(fixedBytes) << " MB" << endl;
+        return false;
+    }
+
+    neighbors.assign(n, listLength, filter.prunes());
+    bool computed = false;
+    switch (metric) {
+        case PEARSON: computed = computeNeighbors<PearsonMetric>(); break;
+        case COSINE: computed = computeNeighbors<CosineMetric>(); break;
+        case EUCLIDEAN: computed = computeNeighbors<EuclideanMetric>(); break;
+        case JACCARD: computed = computeNeighbors<JaccardMetric>(); break;
+    }
+    if (!computed) return false;
+    if (!writePredictions("predictions.txt")) return false;
+
+    cout << fixed << setprecision(1) << "Memoria estimada máxima: " << toMegabytes(peakBytes) << " MB" << endl;
+    return true;
+}
@@ -0,0 +1,80 @@
+#ifndef STREAMING_RECOMMENDER_H
+#define STREAMING_RECOMMENDER_H
+
+#include "UtilityMatrix.h"
+#include "BinaryFormat.h"
+#include "RecommenderSystem.h"
+#include "NeighborIndex.h"
+#include "BlockedPairs.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+using namespace std;
+
+// Filas de un subconjunto de usuarios leídas del archivo binario, en CSR
+struct RowBlock {
+    vector<int> users; // ids globales, ordenados
+    vector<int64_t> start;
+    vector<int> items;
+    vector<float> values;
+
+    void clear();
+    size_t bytes() const;
+    SparseRow row(int local) const;
+    // Posición local del usuario, o -1 si no está en el bloque
+    int find(int user) const;
+};
+
+// Proceso completo sin cargar la matriz en memoria: lee bloques de usuarios
+// del archivo binario, calcula la similitud de cada par de bloques y solo
+// guarda los mejores vecinos de cada usuario; después predice bloque a bloque
+// y escribe las predicciones a medida que se calculan. La memoria máxima
+// depende del presupuesto y de U x (longitud de las listas), no de U²
+class StreamingRecommender {
+private:
+    string filename;
+    Metric metric;
+    PairFilter filter;
+    int numNeighbors;
+    PredictionType predictionType;
+    int numThreads;
+    int listLength;
+    size_t memoryBudget;
+
+    ifstream file;
+    BinaryHeader header;
+    vector<int64_t> rowStart;
+    vector<UserStats> userStats;
+    // Listas de vecinos acotadas a listLength entradas por usuario
+    NeighborIndex neighbors;
+    // Paneles empaquetados por hilo, reutilizados en todos los pares de bloques
+    vector<BlockPanel> panels;
+    size_t fixedBytes;
+    size_t peakBytes;
+
+    bool open();
+    size_t rowBytes(int user) const;
+    bool readRows(int first, int last, RowBlock& block);
+    bool readUsers(const vector<int>& users, RowBlock& block);
+    // Ítems de las filas leídas en [0, numItems) y ordenados: indexan los
+    // paneles y los acumuladores de predicción
+    bool validateBlock(const RowBlock& block) const;
+    void computeUserStats(const RowBlock& block);
+    // Especializados en la métrica (M = PearsonMetric, ...), elegida una vez en run
+    template <typename M>
+    void crossBlocks(const RowBlock& a, const RowBlock& b, vector<double>& tile);
+    template <typename M>
+    bool computeNeighbors();
+    bool writePredictions(const string& outputFile);
+    void trackMemory(size_t bytes);
+
+public:
+    StreamingRecommender(const string& filename, const RecommenderOptions& options, size_t memoryBudget);
+    // Devuelve false si el archivo no es válido o el presupuesto no basta
+    bool run();
+};
+
+#endif
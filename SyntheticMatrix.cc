@@ -0,0 +1,52 @@
+#include "SyntheticMatrix.h"
+#include "Random.h"
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+
+using namespace std;
+
+SyntheticSpec::SyntheticSpec()
+    : users(100), items(1000), density(0.5), minRating(0.0), maxRating(5.0), seed(1) {}
+
+string syntheticFileName(const SyntheticSpec& spec) {
+    char suffix[96];
+    snprintf(suffix, sizeof(suffix), "-d%g-r%g_%g.txt", spec.density, spec.minRating, spec.maxRating);
+    return "utility-matrix-" + to_string(spec.users) + "-" + to_string(spec.items) + "-" +
+           to_string(spec.seed) + suffix;
+}
+
+bool writeSyntheticMatrix(const SyntheticSpec& spec, const string& filename) {
+    ofstream file(filename);
+    if (!file.is_open()) {
+        cerr << "Error: No se puede crear el archivo " << filename << endl;
+        return false;
+    }
+    
+    char cell[32];
+    snprintf(cell, sizeof(cell), "%.3f\n%.3f\n", spec.minRating, spec.maxRating);
+    file << cell;
+    
+    uint64_t state = spec.seed;
+    double range = spec.maxRating - spec.minRating;
+    string line;
+    for (int user = 0; user < spec.users; user++) {
+        line.clear();
+        for (int item = 0; item < spec.items; item++) {
+            if (nextUniform(state) < spec.density) {
+                int length = snprintf(cell, sizeof(cell), "%.3f ", spec.minRating + range * nextUniform(state));
+                line.append(cell, length);
+            } else {
+                line += "- ";
+            }
+        }
+        line += '\n';
+        file.write(line.data(), line.size());
+    }
+    
+    if (!file) {
+        cerr << "Error: No se pudo escribir el archivo " << filename << endl;
+        return false;
+    }
+    return true;
+}
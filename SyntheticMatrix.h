@@ -0,0 +1,31 @@
+#ifndef SYNTHETIC_MATRIX_H
+#define SYNTHETIC_MATRIX_H
+
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+// Parámetros de una matriz de utilidad sintética: cada celda tiene una
+// calificación uniforme en [minRating, maxRating] con probabilidad density
+struct SyntheticSpec {
+    int users;
+    int items;
+    double density;
+    double minRating;
+    double maxRating;
+    uint64_t seed;
+    
+    SyntheticSpec();
+};
+
+// Nombre con el esquema de los ejemplos más la densidad y el rango, para que
+// dos especificaciones distintas no compartan archivo:
+// utility-matrix-<usuarios>-<ítems>-<semilla>-d<densidad>-r<mínimo>_<máximo>.txt
+string syntheticFileName(const SyntheticSpec& spec);
+
+// Escribe la matriz en formato de texto (mínimo, máximo y una fila por
+// usuario con '-' en los huecos). La misma semilla da el mismo archivo
+bool writeSyntheticMatrix(const SyntheticSpec& spec, const string& filename);
+
+#endif
@@ -1,54 +1,735 @@
 #include "UtilityMatrix.h"
+#include "MappedFile.h"
+#include "ContentHash.h"
+#include "PredictionSet.h"
+#include "ParallelFor.h"
+#include "BinaryFormat.h"
+#include "Random.h"
 #include <iostream>
 #include <fstream>
-#include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
 
 using namespace std;
 
-UtilityMatrix::UtilityMatrix() : numUsers(0), numItems(0), minRating(0.0), maxRating(0.0) {}
+// Densidad mínima a partir de la cual compensa mantener la vista densa: por
+// debajo, recorrer las listas dispersas es más barato que las máscaras
+static const double kDenseViewMinDensity = 1.0 / 16.0;
+// Densidad mínima para las máscaras de bits por usuario y por ítem: por
+// debajo ocupan más que las propias listas CSR y CSC, salvo que sean pequeñas
+static const double kRatedMaskMinDensity = 1.0 / 64.0;
+static const double kRatedMaskSmallBytes = 16.0 * 1024 * 1024;
 
-bool UtilityMatrix::loadFromFile(const string& filename) {
-    ifstream file(filename);
-    if (!file.is_open()) {
+bool isBinaryMatrix(const char* data, size_t size) {
+    return size >= sizeof(kBinaryMagic) && memcmp(data, kBinaryMagic, sizeof(kBinaryMagic)) == 0;
+}
+
+// count x width bytes, o más que el archivo si el producto no cabe en él:
+// se comprueba antes de multiplicar, así que unas dimensiones enormes no
+// desbordan 64 bits ni dan por casualidad el tamaño de una sección pequeña
+static uint64_t sectionBytes(uint64_t count, uint64_t width, uint64_t fileSize) {
+    return count > fileSize / width ? UINT64_MAX : count * width;
+}
+
+bool validateBinaryHeader(const BinaryHeader& header, uint64_t fileSize, const string& filename) {
+    if (header.version != kBinaryVersion || header.byteOrder != kByteOrderMark) {
+        cerr << "Error: " << filename << ": versión u orden de bytes del formato binario no soportado" << endl;
+        return false;
+    }
+    if (header.numUsers < 0 || header.numItems < 0 || header.numRatings < 0 || header.maskWords < 0) {
+        cerr << "Error: " << filename << ": cabecera binaria no válida" << endl;
+        return false;
+    }
+    
+    // Tamaño esperado de cada sección según las dimensiones de la cabecera
+    uint64_t users = header.numUsers, items = header.numItems, ratings = header.numRatings;
+    bool dense = header.flags & kHasDenseView;
+    bool masks = header.flags & (kHasDenseView | kHasRatedMask);
+    bool stats = header.flags & kHasUserStats;
+    if (masks && header.maskWords != (header.numItems + 63) / 64) {
+        cerr << "Error: " << filename << ": cabecera binaria no válida" << endl;
+        return false;
+    }
+    uint64_t words = header.maskWords;
+    uint64_t expected[NUM_SECTIONS] = {
+        sectionBytes(users + 1, sizeof(int64_t), fileSize),
+        sectionBytes(ratings, sizeof(int), fileSize),
+        sectionBytes(ratings, sizeof(float), fileSize),
+        sectionBytes(items + 1, sizeof(int64_t), fileSize),
+        sectionBytes(ratings, sizeof(int), fileSize),
+        sectionBytes(ratings, sizeof(float), fileSize),
+        dense ? sectionBytes(users, words * 64 * sizeof(float), fileSize) : 0,
+        masks ? sectionBytes(users, words * sizeof(uint64_t), fileSize) : 0,
+        stats ? sectionBytes(users, sizeof(UserStats), fileSize) : 0
+    };
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        if (header.sectionSize[s] != expected[s] || header.sectionOffset[s] % 64 != 0 ||
+            header.sectionOffset[s] > fileSize || header.sectionSize[s] > fileSize - header.sectionOffset[s]) {
+            cerr << "Error: " << filename << ": sección " << s << " del formato binario no válida" << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool validateOffsets(const int64_t* start, int count, int64_t total, const string& filename) {
+    bool valid = start[0] == 0 && start[count] == total;
+    for (int i = 0; i < count && valid; i++) {
+        valid = start[i] <= start[i + 1];
+    }
+    if (!valid) {
+        cerr << "Error: " << filename << ": desplazamientos del formato binario no válidos" << endl;
+    }
+    return valid;
+}
+
+UtilityMatrix::UtilityMatrix()
+    : numUsers(0), numItems(0), minRating(0.0), maxRating(0.0), maskWords(0), raterWords(0), denseView(false) {
+    refreshView();
+}
+
+static bool isSeparator(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* findLineEnd(const char* p, const char* end) {
+    const char* newline = (const char*)memchr(p, '\n', end - p);
+    return newline ? newline : end;
+}
+
+// Convierte el token [p, end) en número sin copias. Devuelve false si el
+// token no es un número completo
+static bool parseNumber(const char* p, const char* end, double& value) {
+    static const double powers[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* token = p;
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+    
+    uint64_t mantissa = 0;
+    int digits = 0, scale = 0;
+    bool any = false;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+        if (digits < 19) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if (mantissa > 0) digits++;
+        } else {
+            scale++;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, any = true) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa > 0) digits++;
+                scale--;
+            }
+        }
+    }
+    if (!any) return false;
+    
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        bool negativeExp = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExp = *p == '-';
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9') return false;
+        int exponent = 0;
+        for (; p < end && *p >= '0' && *p <= '9'; p++) {
+            if (exponent < 10000) exponent = exponent * 10 + (*p - '0');
+        }
+        scale += negativeExp ? -exponent : exponent;
+    }
+    if (p != end) return false;
+    
+    if (mantissa == 0) {
+        value = 0.0;
+    } else if (scale >= 0 && scale <= 22) {
+        value = (double)mantissa * powers[scale];
+    } else if (scale < 0 && scale >= -22) {
+        value = (double)mantissa / powers[-scale];
+    } else {
+        // Exponentes extremos: caso raro, se delega en strtod
+        char buffer[64];
+        size_t length = min((size_t)(end - token), sizeof(buffer) - 1);
+        memcpy(buffer, token, length);
+        buffer[length] = '\0';
+        value = strtod(buffer, nullptr);
+        return true;
+    }
+    if (negative) value = -value;
+    return true;
+}
+
+static string tokenText(const char* p, const char* end) {
+    return string(p, min((size_t)(end - p), (size_t)32));
+}
+
+// Lee una línea de cabecera (rango de calificaciones) y avanza p
+static bool parseHeaderLine(const char*& p, const char* end, int lineNumber, double& value) {
+    const char* lineEnd = findLineEnd(p, end);
+    const char* first = p;
+    const char* last = lineEnd;
+    while (first < last && isSeparator(*first)) first++;
+    while (last > first && isSeparator(last[-1])) last--;
+    
+    if (p == end || !parseNumber(first, last, value)) {
+        cerr << "Error: línea " << lineNumber << ": se esperaba un valor numérico para el rango de calificaciones" << endl;
+        return false;
+    }
+    p = lineEnd < end ? lineEnd + 1 : end;
+    return true;
+}
+
+// Fragmento del archivo alineado a líneas que se procesa en un hilo
+struct TextChunk {
+    const char* begin;
+    const char* end;
+    int lineCount;
+    int firstLine;
+    int firstRow;
+    vector<int> rowLine;     // línea (relativa al fragmento) de cada fila
+    vector<int> rowTokens;   // valores por fila, incluidos los '-'
+    vector<int> rowRatings;  // calificaciones presentes por fila
+    int errorLine;
+    string error;
+};
+
+// Primera pasada: contar filas, valores y calificaciones sin convertir nada
+static void scanChunk(TextChunk& chunk) {
+    chunk.lineCount = 0;
+    for (const char* p = chunk.begin; p < chunk.end; ) {
+        const char* lineEnd = findLineEnd(p, chunk.end);
+        int tokens = 0, ratings = 0;
+        while (p < lineEnd) {
+            while (p < lineEnd && isSeparator(*p)) p++;
+            if (p == lineEnd) break;
+            const char* token = p;
+            while (p < lineEnd && !isSeparator(*p)) p++;
+            tokens++;
+            if (!(p - token == 1 && *token == '-')) ratings++;
+        }
+        if (tokens > 0) {
+            chunk.rowLine.push_back(chunk.lineCount);
+            chunk.rowTokens.push_back(tokens);
+            chunk.rowRatings.push_back(ratings);
+        }
+        chunk.lineCount++;
+        p = lineEnd + 1;
+    }
+}
+
+bool UtilityMatrix::loadFromFile(const string& filename, int numThreads) {
+    shared_ptr<MappedFile> file = make_shared<MappedFile>();
+    if (!file->open(filename)) {
         cerr << "Error: No se puede abrir el archivo " << filename << endl;
         return false;
     }
     
-    string line;
+    mapping.reset();
+    if (isBinaryMatrix(file->data(), file->size())) {
+        return loadBinary(file, filename);
+    }
+    return loadText(*file, numThreads);
+}
+
+bool UtilityMatrix::loadText(const MappedFile& file, int numThreads) {
+    const char* p = file.data();
+    const char* end = p + file.size();
     
     // Leer rango de calificaciones
-    getline(file, line);
-    minRating = stod(line);
-    getline(file, line);
-    maxRating = stod(line);
-    
-    // Leer matriz de utilidad
-    while (getline(file, line)) {
-        vector<double> userRatings;
-        stringstream ss(line);
-        string value;
-        
-        while (ss >> value) {
-            if (value == "-") {
-                userRatings.push_back(-1.0); // -1 indica valor faltante
-            } else {
-                userRatings.push_back(stod(value));
+    if (!parseHeaderLine(p, end, 1, minRating) || !parseHeaderLine(p, end, 2, maxRating)) {
+        return false;
+    }
+    
+    // Dividir el cuerpo en fragmentos que empiezan al inicio de una línea
+    const size_t minChunkBytes = 1 << 20;
+    int threads = resolveThreadCount(numThreads);
+    int numChunks = (int)min((size_t)threads, (size_t)(end - p) / minChunkBytes + 1);
+    vector<TextChunk> chunks(numChunks);
+    const char* chunkBegin = p;
+    for (int c = 0; c < numChunks; c++) {
+        const char* chunkEnd = end;
+        if (c + 1 < numChunks) {
+            chunkEnd = p + (size_t)(end - p) * (c + 1) / numChunks;
+            if (chunkEnd < chunkBegin) chunkEnd = chunkBegin;
+            chunkEnd = findLineEnd(chunkEnd, end);
+            if (chunkEnd < end) chunkEnd++;
+        }
+        chunks[c].begin = chunkBegin;
+        chunks[c].end = chunkEnd;
+        chunks[c].errorLine = 0;
+        chunkBegin = chunkEnd;
+    }
+    
+    parallelFor(0, numChunks, threads, 1, [&](int c, int) {
+        scanChunk(chunks[c]);
+    });
+    
+    // Numerar líneas y filas, comprobar el ancho y reservar el CSR de una vez
+    int line = 3, rows = 0;
+    int64_t ratings = 0;
+    numItems = 0;
+    for (int c = 0; c < numChunks; c++) {
+        chunks[c].firstLine = line;
+        chunks[c].firstRow = rows;
+        for (size_t r = 0; r < chunks[c].rowTokens.size(); r++) {
+            if (rows == 0) {
+                numItems = chunks[c].rowTokens[r];
+            } else if (chunks[c].rowTokens[r] != numItems) {
+                cerr << "Error: línea " << line + chunks[c].rowLine[r] << ": se esperaban "
+                     << numItems << " valores y hay " << chunks[c].rowTokens[r] << endl;
+                return false;
             }
+            rows++;
+            ratings += chunks[c].rowRatings[r];
         }
-        
-        if (!userRatings.empty()) {
-            ratings.push_back(userRatings);
+        line += chunks[c].lineCount;
+    }
+    
+    numUsers = rows;
+    rowStart.resize(numUsers + 1);
+    rowItems.resize(ratings);
+    rowValues.resize(ratings);
+    rowStart[0] = 0;
+    for (int c = 0, u = 0; c < numChunks; c++) {
+        for (size_t r = 0; r < chunks[c].rowRatings.size(); r++, u++) {
+            rowStart[u + 1] = rowStart[u] + chunks[c].rowRatings[r];
+        }
+    }
+    
+    // Segunda pasada: convertir los valores directamente en su posición final
+    parallelFor(0, numChunks, threads, 1, [&](int c, int) {
+        TextChunk& chunk = chunks[c];
+        int row = chunk.firstRow;
+        int lineIndex = 0;
+        for (const char* q = chunk.begin; q < chunk.end; lineIndex++) {
+            const char* lineEnd = findLineEnd(q, chunk.end);
+            int64_t out = row < numUsers ? rowStart[row] : 0;
+            int item = 0;
+            while (q < lineEnd) {
+                while (q < lineEnd && isSeparator(*q)) q++;
+                if (q == lineEnd) break;
+                const char* token = q;
+                while (q < lineEnd && !isSeparator(*q)) q++;
+                if (!(q - token == 1 && *token == '-')) {
+                    double value;
+                    if (!parseNumber(token, q, value)) {
+                        chunk.errorLine = chunk.firstLine + lineIndex;
+                        chunk.error = "valor no válido '" + tokenText(token, q) + "'";
+                        return;
+                    }
+                    rowItems[out] = item;
+                    rowValues[out] = (float)value;
+                    out++;
+                }
+                item++;
+            }
+            if (item > 0) row++;
+            q = lineEnd + 1;
+        }
+    });
+    
+    for (int c = 0; c < numChunks; c++) {
+        if (chunks[c].errorLine > 0) {
+            cerr << "Error: línea " << chunks[c].errorLine << ": " << chunks[c].error << endl;
+            return false;
         }
     }
     
-    numUsers = ratings.size();
-    numItems = numUsers > 0 ? ratings[0].size() : 0;
+    buildColumnIndex();
+    refreshView();
+    buildRatedMasks();
+    buildDenseView();
+    refreshView();
+    computeUserStats();
+    return true;
+}
+
+bool UtilityMatrix::loadBinary(const shared_ptr<MappedFile>& file, const string& filename) {
+    const char* base = file->data();
+    size_t size = file->size();
+    BinaryHeader header;
+    if (size < sizeof(header)) {
+        cerr << "Error: " << filename << ": cabecera binaria incompleta" << endl;
+        return false;
+    }
+    memcpy(&header, base, sizeof(header));
+    if (!validateBinaryHeader(header, size, filename)) {
+        return false;
+    }
+    bool dense = header.flags & kHasDenseView;
+    bool masks = header.flags & (kHasDenseView | kHasRatedMask);
+    bool stats = header.flags & kHasUserStats;
+    
+    numUsers = header.numUsers;
+    numItems = header.numItems;
+    minRating = header.minRating;
+    maxRating = header.maxRating;
+    maskWords = masks ? header.maskWords : 0;
+    denseView = dense;
+    rowStart.clear(); rowItems.clear(); rowValues.clear();
+    colStart.clear(); colUsers.clear(); colValues.clear();
+    denseValues.clear(); ratedMask.clear();
+    
+    // Las vistas apuntan directamente al archivo proyectado
+    view.rowStart = (const int64_t*)(base + header.sectionOffset[SEC_ROW_START]);
+    view.rowItems = (const int*)(base + header.sectionOffset[SEC_ROW_ITEMS]);
+    view.rowValues = (const float*)(base + header.sectionOffset[SEC_ROW_VALUES]);
+    view.colStart = (const int64_t*)(base + header.sectionOffset[SEC_COL_START]);
+    view.colUsers = (const int*)(base + header.sectionOffset[SEC_COL_USERS]);
+    view.colValues = (const float*)(base + header.sectionOffset[SEC_COL_VALUES]);
+    view.denseValues = (const float*)(base + header.sectionOffset[SEC_DENSE_VALUES]);
+    view.ratedMask = (const uint64_t*)(base + header.sectionOffset[SEC_RATED_MASK]);
+    const UserStats* stored = stats ? (const UserStats*)(base + header.sectionOffset[SEC_USER_STATS]) : nullptr;
+    
+    // Los índices del archivo se usan luego sin comprobar (máscaras, búsquedas
+    // en las filas): un archivo dañado debe fallar aquí y no escribir fuera
+    if (!validateOffsets(view.rowStart, numUsers, header.numRatings, filename) ||
+        !validateOffsets(view.colStart, numItems, header.numRatings, filename) ||
+        !validateIndices(stored, filename)) {
+        numUsers = numItems = maskWords = 0;
+        refreshView();
+        return false;
+    }
+    mapping = file;
+    
+    // Las máscaras por ítem no se guardan: se construyen en una pasada (y las
+    // de usuario también si el archivo no las trae)
+    buildRatedMasks(masks);
+    if (!masks) view.ratedMask = ratedMask.data();
+    view.raterMask = raterMask.data();
     
-    file.close();
+    if (stats) {
+        userStats.assign(stored, stored + numUsers);
+    } else {
+        computeUserStats();
+    }
     return true;
 }
 
+bool UtilityMatrix::validateIndices(const UserStats* stored, const string& filename) const {
+    // Filas: ítems en [0, numItems) estrictamente crecientes, presentes en la
+    // máscara del usuario si el archivo la trae y con la misma cuenta que ella.
+    // Recorriendo los usuarios en orden, cada calificación debe ser además la
+    // siguiente entrada de la columna de su ítem: las columnas son la
+    // traspuesta exacta de las filas
+    vector<int64_t> cursor(view.colStart, view.colStart + numItems);
+    for (int u = 0; u < numUsers; u++) {
+        int previous = -1;
+        int64_t count = view.rowStart[u + 1] - view.rowStart[u];
+        const uint64_t* mask = maskWords > 0 ? view.ratedMask + (size_t)u * maskWords : nullptr;
+        for (int64_t k = view.rowStart[u]; k < view.rowStart[u + 1]; k++) {
+            int item = view.rowItems[k];
+            if (item <= previous || item >= numItems || (mask && !((mask[item / 64] >> (item % 64)) & 1)) ||
+                cursor[item] >= view.colStart[item + 1] || view.colUsers[cursor[item]] != u) {
+                cerr << "Error: " << filename << ": índices no válidos en la fila del usuario " << u << endl;
+                return false;
+            }
+            previous = item;
+            cursor[item]++;
+        }
+        int64_t bits = 0;
+        for (int w = 0; mask && w < maskWords; w++) {
+            bits += __builtin_popcountll(mask[w]);
+        }
+        if ((mask && bits != count) || (stored && stored[u].count != count)) {
+            cerr << "Error: " << filename << ": máscara o estadísticas no válidas para el usuario " << u << endl;
+            return false;
+        }
+    }
+    
+    for (int i = 0; i < numItems; i++) {
+        if (cursor[i] != view.colStart[i + 1]) {
+            cerr << "Error: " << filename << ": índices no válidos en la columna del ítem " << i << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UtilityMatrix::saveBinary(const string& filename) const {
+    ofstream file(filename, ios::binary);
+    if (!file.is_open()) {
+        cerr << "Error: No se puede crear el archivo " << filename << endl;
+        return false;
+    }
+    
+    BinaryHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, kBinaryMagic, sizeof(kBinaryMagic));
+    header.version = kBinaryVersion;
+    header.byteOrder = kByteOrderMark;
+    header.flags = kHasUserStats | (hasDenseView() ? kHasDenseView : hasRatedMasks() ? kHasRatedMask : 0);
+    header.numUsers = numUsers;
+    header.numItems = numItems;
+    header.maskWords = maskWords;
+    header.numRatings = getNumRatings();
+    header.minRating = minRating;
+    header.maxRating = maxRating;
+    
+    // Copia de las estadísticas con el relleno de la estructura a cero: el
+    // archivo no depende de la memoria sin inicializar
+    vector<UserStats> stats(numUsers);
+    memset((void*)stats.data(), 0, stats.size() * sizeof(UserStats));
+    for (int u = 0; u < numUsers; u++) {
+        stats[u].count = userStats[u].count;
+        stats[u].sum = userStats[u].sum;
+        stats[u].sumSquares = userStats[u].sumSquares;
+        stats[u].mean = userStats[u].mean;
+        stats[u].norm = userStats[u].norm;
+    }
+    
+    uint64_t users = numUsers, ratings = header.numRatings;
+    const void* sections[NUM_SECTIONS] = {
+        view.rowStart, view.rowItems, view.rowValues,
+        view.colStart, view.colUsers, view.colValues,
+        view.denseValues, view.ratedMask, stats.data()
+    };
+    header.sectionSize[SEC_ROW_START] = (users + 1) * sizeof(int64_t);
+    header.sectionSize[SEC_ROW_ITEMS] = ratings * sizeof(int);
+    header.sectionSize[SEC_ROW_VALUES] = ratings * sizeof(float);
+    header.sectionSize[SEC_COL_START] = ((uint64_t)numItems + 1) * sizeof(int64_t);
+    header.sectionSize[SEC_COL_USERS] = ratings * sizeof(int);
+    header.sectionSize[SEC_COL_VALUES] = ratings * sizeof(float);
+    header.sectionSize[SEC_DENSE_VALUES] = denseView ? users * maskWords * 64 * sizeof(float) : 0;
+    header.sectionSize[SEC_RATED_MASK] = users * maskWords * sizeof(uint64_t);
+    header.sectionSize[SEC_USER_STATS] = users * sizeof(UserStats);
+    
+    // Secciones alineadas a 64 bytes tras la cabecera
+    uint64_t offset = (sizeof(header) + 63) / 64 * 64;
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        header.sectionOffset[s] = offset;
+        offset += (header.sectionSize[s] + 63) / 64 * 64;
+    }
+    
+    static const char padding[64] = {0};
+    file.write((const char*)&header, sizeof(header));
+    uint64_t written = sizeof(header);
+    for (int s = 0; s < NUM_SECTIONS; s++) {
+        file.write(padding, header.sectionOffset[s] - written);
+        if (header.sectionSize[s] > 0) {
+            file.write((const char*)sections[s], header.sectionSize[s]);
+        }
+        written = header.sectionOffset[s] + header.sectionSize[s];
+    }
+    
+    if (!file) {
+        cerr << "Error: No se pudo escribir el archivo " << filename << endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t UtilityMatrix::contentHash() const {
+    int64_t ratings = getNumRatings();
+    int32_t dims[2] = {numUsers, numItems};
+    double range[2] = {minRating, maxRating};
+    uint64_t hash = hashBytes(dims, sizeof(dims));
+    hash = hashBytes(range, sizeof(range), hash);
+    hash = hashBytes(view.rowStart, ((size_t)numUsers + 1) * sizeof(int64_t), hash);
+    hash = hashBytes(view.rowItems, ratings * sizeof(int), hash);
+    return hashBytes(view.rowValues, ratings * sizeof(float), hash);
+}
+
+void UtilityMatrix::refreshView() {
+    view.rowStart = rowStart.data();
+    view.rowItems = rowItems.data();
+    view.rowValues = rowValues.data();
+    view.colStart = colStart.data();
+    view.colUsers = colUsers.data();
+    view.colValues = colValues.data();
+    view.denseValues = denseValues.data();
+    view.ratedMask = ratedMask.data();
+    view.raterMask = raterMask.data();
+}
+
+void UtilityMatrix::materialize() {
+    // Copiar a memoria propia el contenido proyectado antes de modificarlo
+    if (!mapping) return;
+    int64_t ratings = getNumRatings();
+    rowStart.assign(view.rowStart, view.rowStart + numUsers + 1);
+    rowItems.assign(view.rowItems, view.rowItems + ratings);
+    rowValues.assign(view.rowValues, view.rowValues + ratings);
+    colStart.assign(view.colStart, view.colStart + numItems + 1);
+    colUsers.assign(view.colUsers, view.colUsers + ratings);
+    colValues.assign(view.colValues, view.colValues + ratings);
+    // Las máscaras por ítem, y las de usuario si no venían en el archivo, ya son propias
+    size_t maskSize = (size_t)numUsers * maskWords;
+    denseValues.assign(view.denseValues, view.denseValues + (denseView ? maskSize * 64 : 0));
+    if (view.ratedMask != ratedMask.data()) {
+        ratedMask.assign(view.ratedMask, view.ratedMask + maskSize);
+    }
+    mapping.reset();
+    refreshView();
+}
+
+void UtilityMatrix::transposeFrom(const UtilityMatrix& source) {
+    numUsers = source.numItems;
+    numItems = source.numUsers;
+    minRating = source.minRating;
+    maxRating = source.maxRating;
+    mapping.reset();
+    
+    // Las columnas de source ya están ordenadas por usuario: son las filas CSR
+    int64_t total = source.getNumRatings();
+    rowStart.assign(source.view.colStart, source.view.colStart + numUsers + 1);
+    rowItems.assign(source.view.colUsers, source.view.colUsers + total);
+    rowValues.assign(source.view.colValues, source.view.colValues + total);
+    
+    buildColumnIndex();
+    refreshView();
+    buildRatedMasks();
+    buildDenseView();
+    refreshView();
+    computeUserStats();
+}
+
+void UtilityMatrix::holdOut(double fraction, uint64_t seed, vector<RatingCell>& heldOut) {
+    materialize();
+    heldOut.clear();
+    
+    // Una sola pasada compactando las filas CSR; después se reconstruyen el
+    // índice CSC, las máscaras y las estadísticas como al cargar
+    uint64_t state = seed;
+    int64_t out = 0;
+    for (int u = 0; u < numUsers; u++) {
+        int64_t first = rowStart[u], last = rowStart[u + 1];
+        rowStart[u] = out;
+        for (int64_t k = first; k < last; k++) {
+            bool keepOne = out == rowStart[u] && k == last - 1;
+            if (nextUniform(state) < fraction && !keepOne) {
+                heldOut.push_back({u, rowItems[k], rowValues[k]});
+            } else {
+                rowItems[out] = rowItems[k];
+                rowValues[out] = rowValues[k];
+                out++;
+            }
+        }
+    }
+    rowStart[numUsers] = out;
+    rowItems.resize(out);
+    rowValues.resize(out);
+    
+    buildColumnIndex();
+    refreshView();
+    buildRatedMasks();
+    buildDenseView();
+    refreshView();
+    computeUserStats();
+}
+
+void UtilityMatrix::buildColumnIndex() {
+    // Transposición por conteo: CSR -> CSC
+    colStart.assign(numItems + 1, 0);
+    for (size_t k = 0; k < rowItems.size(); k++) {
+        colStart[rowItems[k] + 1]++;
+    }
+    for (int i = 0; i < numItems; i++) {
+        colStart[i + 1] += colStart[i];
+    }
+    
+    colUsers.resize(rowItems.size());
+    colValues.resize(rowItems.size());
+    vector<int64_t> next(colStart.begin(), colStart.end() - 1);
+    for (int u = 0; u < numUsers; u++) {
+        for (int64_t k = rowStart[u]; k < rowStart[u + 1]; k++) {
+            int64_t pos = next[rowItems[k]]++;
+            colUsers[pos] = u;
+            colValues[pos] = rowValues[k];
+        }
+    }
+}
+
+void UtilityMatrix::buildRatedMasks(bool keepUserMasks) {
+    if (!keepUserMasks) {
+        ratedMask.clear();
+        maskWords = 0;
+    }
+    raterMask.clear();
+    raterWords = 0;
+    if (numUsers == 0 || numItems == 0) return;
+    if (!keepUserMasks && (double)getNumRatings() < kRatedMaskMinDensity * numUsers * numItems &&
+        (double)numUsers * numItems / 4 > kRatedMaskSmallBytes) {
+        return;
+    }
+    
+    // Filas alineadas a palabras de 64 items para que los kernels no tengan cola
+    maskWords = (numItems + 63) / 64;
+    raterWords = (numUsers + 63) / 64;
+    if (!keepUserMasks) ratedMask.assign((size_t)numUsers * maskWords, 0);
+    raterMask.assign((size_t)numItems * raterWords, 0);
+    for (int u = 0; u < numUsers; u++) {
+        for (int64_t k = view.rowStart[u]; k < view.rowStart[u + 1]; k++) {
+            int item = view.rowItems[k];
+            if (!keepUserMasks) ratedMask[(size_t)u * maskWords + item / 64] |= (uint64_t)1 << (item % 64);
+            raterMask[(size_t)item * raterWords + u / 64] |= (uint64_t)1 << (u % 64);
+        }
+    }
+}
+
+void UtilityMatrix::buildDenseView() {
+    denseValues.clear();
+    denseView = false;
+    if (!hasRatedMasks()) return;
+    if ((double)rowItems.size() < kDenseViewMinDensity * numUsers * numItems) return;
+    
+    // Mismo paso que las máscaras: filas de maskWords x 64 valores
+    denseView = true;
+    size_t stride = (size_t)maskWords * 64;
+    denseValues.assign((size_t)numUsers * stride, 0.0f);
+    for (int u = 0; u < numUsers; u++) {
+        for (int64_t k = rowStart[u]; k < rowStart[u + 1]; k++) {
+            denseValues[u * stride + rowItems[k]] = rowValues[k];
+        }
+    }
+}
+
+void UtilityMatrix::computeUserStats() {
+    userStats.resize(numUsers);
+    for (int u = 0; u < numUsers; u++) {
+        UserStats& stats = userStats[u];
+        stats.count = (int)(view.rowStart[u + 1] - view.rowStart[u]);
+        stats.sum = 0.0;
+        stats.sumSquares = 0.0;
+        for (int64_t k = view.rowStart[u]; k < view.rowStart[u + 1]; k++) {
+            stats.sum += view.rowValues[k];
+            stats.sumSquares += (double)view.rowValues[k] * view.rowValues[k];
+        }
+        refreshUserStats(u);
+    }
+}
+
+void UtilityMatrix::refreshUserStats(int user) {
+    UserStats& stats = userStats[user];
+    stats.mean = stats.count > 0 ? stats.sum / stats.count : 0.0;
+    stats.norm = sqrt(stats.sumSquares);
+}
+
+int64_t UtilityMatrix::findInRow(int user, int item) const {
+    const int* first = view.rowItems + view.rowStart[user];
+    const int* last = view.rowItems + view.rowStart[user + 1];
+    const int* it = lower_bound(first, last, item);
+    return (it != last && *it == item) ? (int64_t)(it - view.rowItems) : -1;
+}
+
+int64_t UtilityMatrix::findInColumn(int item, int user) const {
+    const int* first = view.colUsers + view.colStart[item];
+    const int* last = view.colUsers + view.colStart[item + 1];
+    const int* it = lower_bound(first, last, user);
+    return (it != last && *it == user) ? (int64_t)(it - view.colUsers) : -1;
+}
+
 int UtilityMatrix::getNumUsers() const { 
     return numUsers; 
 }
@@ -57,6 +738,10 @@ int UtilityMatrix::getNumItems() const {
     return numItems; 
 }
 
+long long UtilityMatrix::getNumRatings() const {
+    return numUsers > 0 ? view.rowStart[numUsers] : 0;
+}
+
 double UtilityMatrix::getMinRating() const { 
     return minRating; 
 }
@@ -66,30 +751,158 @@ double UtilityMatrix::getMaxRating() const {
 }
 
 double UtilityMatrix::getRating(int user, int item) const { 
-    return ratings[user][item]; 
+    int64_t pos = findInRow(user, item);
+    return pos >= 0 ? view.rowValues[pos] : -1.0; // -1 indica valor faltante
 }
 
 void UtilityMatrix::setRating(int user, int item, double value) { 
-    ratings[user][item] = value; 
+    materialize();
+    int64_t pos = findInRow(user, item);
+    float stored = (float)value;
+    
+    // Actualizar las estadísticas del usuario con la diferencia
+    UserStats& stats = userStats[user];
+    if (pos >= 0) {
+        stats.sum -= rowValues[pos];
+        stats.sumSquares -= (double)rowValues[pos] * rowValues[pos];
+    } else {
+        stats.count++;
+    }
+    stats.sum += stored;
+    stats.sumSquares += (double)stored * stored;
+    refreshUserStats(user);
+    if (hasRatedMasks()) {
+        ratedMask[(size_t)user * maskWords + item / 64] |= (uint64_t)1 << (item % 64);
+        raterMask[(size_t)item * raterWords + user / 64] |= (uint64_t)1 << (user % 64);
+    }
+    if (hasDenseView()) {
+        denseValues[(size_t)user * maskWords * 64 + item] = stored;
+    }
+    
+    if (pos >= 0) {
+        rowValues[pos] = stored;
+        colValues[findInColumn(item, user)] = stored;
+        return;
+    }
+    
+    // Las inserciones pueden mover los búferes: actualizar las vistas al final
+    
+    // Insertar manteniendo el orden de items dentro de la fila
+    int64_t rowPos = lower_bound(rowItems.begin() + rowStart[user], rowItems.begin() + rowStart[user + 1], item) - rowItems.begin();
+    rowItems.insert(rowItems.begin() + rowPos, item);
+    rowValues.insert(rowValues.begin() + rowPos, stored);
+    for (int u = user + 1; u <= numUsers; u++) {
+        rowStart[u]++;
+    }
+    
+    int64_t colPos = lower_bound(colUsers.begin() + colStart[item], colUsers.begin() + colStart[item + 1], user) - colUsers.begin();
+    colUsers.insert(colUsers.begin() + colPos, user);
+    colValues.insert(colValues.begin() + colPos, stored);
+    for (int i = item + 1; i <= numItems; i++) {
+        colStart[i]++;
+    }
+    refreshView();
+}
+
+void UtilityMatrix::removeRating(int user, int item) {
+    materialize();
+    int64_t pos = findInRow(user, item);
+    if (pos < 0) return;
+    
+    UserStats& stats = userStats[user];
+    stats.count--;
+    stats.sum -= rowValues[pos];
+    stats.sumSquares -= (double)rowValues[pos] * rowValues[pos];
+    if (stats.count == 0) {
+        stats.sum = 0.0;
+        stats.sumSquares = 0.0;
+    }
+    refreshUserStats(user);
+    if (hasRatedMasks()) {
+        ratedMask[(size_t)user * maskWords + item / 64] &= ~((uint64_t)1 << (item % 64));
+        raterMask[(size_t)item * raterWords + user / 64] &= ~((uint64_t)1 << (user % 64));
+    }
+    if (hasDenseView()) {
+        denseValues[(size_t)user * maskWords * 64 + item] = 0.0f;
+    }
+    
+    rowItems.erase(rowItems.begin() + pos);
+    rowValues.erase(rowValues.begin() + pos);
+    for (int u = user + 1; u <= numUsers; u++) {
+        rowStart[u]--;
+    }
+    
+    int64_t colPos = findInColumn(item, user);
+    colUsers.erase(colUsers.begin() + colPos);
+    colValues.erase(colValues.begin() + colPos);
+    for (int i = item + 1; i <= numItems; i++) {
+        colStart[i]--;
+    }
+    refreshView();
 }
 
 bool UtilityMatrix::isMissing(int user, int item) const { 
-    return ratings[user][item] == -1.0; 
+    // Por la máscara del ítem: al recorrer los vecinos de una celda el ítem
+    // es fijo, así que todas las consultas caen en la misma fila de bits
+    if (hasRatedMasks()) {
+        return !((view.raterMask[(size_t)item * raterWords + user / 64] >> (user % 64)) & 1);
+    }
+    return findInRow(user, item) < 0; 
 }
 
 double UtilityMatrix::getUserMean(int user) const {
-    double sum = 0.0;
-    int count = 0;
-    for (int i = 0; i < numItems; i++) {
-        if (!isMissing(user, i)) {
-            sum += ratings[user][i];
-            count++;
-        }
-    }
-    return count > 0 ? sum / count : 0.0;
+    return userStats[user].mean;
+}
+
+const UserStats& UtilityMatrix::getUserStats(int user) const {
+    return userStats[user];
+}
+
+SparseRow UtilityMatrix::getUserRow(int user) const {
+    SparseRow row;
+    row.index = view.rowItems + view.rowStart[user];
+    row.value = view.rowValues + view.rowStart[user];
+    row.size = (int)(view.rowStart[user + 1] - view.rowStart[user]);
+    return row;
+}
+
+SparseRow UtilityMatrix::getItemColumn(int item) const {
+    SparseRow column;
+    column.index = view.colUsers + view.colStart[item];
+    column.value = view.colValues + view.colStart[item];
+    column.size = (int)(view.colStart[item + 1] - view.colStart[item]);
+    return column;
+}
+
+bool UtilityMatrix::hasRatedMasks() const {
+    return maskWords > 0;
 }
 
-void UtilityMatrix::print() {
+int UtilityMatrix::getMaskWords() const {
+    return maskWords;
+}
+
+const uint64_t* UtilityMatrix::getRatedMask(int user) const {
+    return view.ratedMask + (size_t)user * maskWords;
+}
+
+int UtilityMatrix::getRaterWords() const {
+    return raterWords;
+}
+
+const uint64_t* UtilityMatrix::getRaterMask(int item) const {
+    return view.raterMask + (size_t)item * raterWords;
+}
+
+bool UtilityMatrix::hasDenseView() const {
+    return denseView;
+}
+
+const float* UtilityMatrix::getDenseRow(int user) const {
+    return view.denseValues + (size_t)user * maskWords * 64;
+}
+
+void UtilityMatrix::print() const {
   if (numUsers >= 25 || numItems >= 25) {
       cout << "Matriz demasiado grande, imprimiendo solo resultados\n";
       return;
@@ -108,14 +921,10 @@ void UtilityMatrix::print() {
         cout << setw(8) << "U" + to_string(i);
         for (int j = 0; j < numItems; j++) {
             if (isMissing(i, j)) {
-                std::pair<int, int> prediccion;
-                prediccion.first = i;
-                prediccion.second = j;
-                predicciones_.push_back(prediccion);
                 cout << setw(8) << "-";
             } else {
 
-                cout << setw(8) << fixed << setprecision(3) << ratings[i][j];
+                cout << setw(8) << fixed << setprecision(3) << getRating(i, j);
             }
         }
         cout << endl;
@@ -123,7 +932,7 @@ void UtilityMatrix::print() {
     cout << endl;
 }
 
-void UtilityMatrix::printPredictions() {
+void UtilityMatrix::printPredictions(const PredictionSet& predictions) const {
     if (numUsers >= 25 || numItems >= 25) {
       cout << "Matriz demasiado grande, imprimiendo solo resultados\n";
       return;
@@ -141,13 +950,13 @@ void UtilityMatrix::printPredictions() {
     for (int i = 0; i < numUsers; i++) {
         cout << setw(8) << "U" + to_string(i);
         for (int j = 0; j < numItems; j++) {    
-          std::pair<int, int> par(i, j);
-          for (auto par_mat : predicciones_) {
-            if (par_mat == par) {
-              cout << "\033[31m";
-            }
+          int64_t k = predictions.find(i, j);
+          if (k >= 0) {
+            cout << "\033[31m";
+            cout << setw(8) << fixed << setprecision(3) << predictions.getValue(k);
+          } else {
+            cout << setw(8) << fixed << setprecision(3) << getRating(i, j);
           }
-          cout << setw(8) << fixed << setprecision(3) << ratings[i][j];
           cout << "\033[0m";
         }
         cout << endl;
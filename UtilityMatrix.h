@@ -3,32 +3,140 @@
 
 #include <vector>
 #include <string>
+#include <memory>
+#include <stdint.h>
+
+class MappedFile;
+class PredictionSet;
 
 using namespace std;
 
+// Vista de una fila (usuario) o columna (item) dispersa: índices ordenados
+// y sus calificaciones, contiguos en memoria
+struct SparseRow {
+    const int* index;
+    const float* value;
+    int size;
+};
+
+// Estadísticas de las calificaciones de un usuario, calculadas al cargar y
+// actualizadas en cada setRating
+struct UserStats {
+    int count;
+    double sum;
+    double sumSquares;
+    double mean;
+    double norm;
+};
+
+// Calificación observada de una celda
+struct RatingCell {
+    int user;
+    int item;
+    float value;
+};
+
 class UtilityMatrix {
 private:
     int numUsers;
     int numItems;
     double minRating;
     double maxRating;
-    vector<vector<double>> ratings;
-    vector<pair<int, int>> predicciones_;
+    // Almacenamiento CSR por usuario
+    vector<int64_t> rowStart;
+    vector<int> rowItems;
+    vector<float> rowValues;
+    // Índice CSC por item
+    vector<int64_t> colStart;
+    vector<int> colUsers;
+    vector<float> colValues;
+    // Índice de co-calificación opcional: máscara de bits de los ítems que
+    // calificó cada usuario y de los usuarios que calificaron cada ítem
+    int maskWords;
+    int raterWords;
+    vector<uint64_t> ratedMask;
+    vector<uint64_t> raterMask;
+    // Vista densa opcional para los kernels vectoriales: filas con 0 en los
+    // huecos, junto a las máscaras por usuario
+    bool denseView;
+    vector<float> denseValues;
+    vector<UserStats> userStats;
     
+    // Punteros de lectura: apuntan a los vectores anteriores o, al abrir un
+    // archivo binario, directamente a su proyección en memoria (sin copias)
+    struct StorageView {
+        const int64_t* rowStart;
+        const int* rowItems;
+        const float* rowValues;
+        const int64_t* colStart;
+        const int* colUsers;
+        const float* colValues;
+        const float* denseValues;
+        const uint64_t* ratedMask;
+        const uint64_t* raterMask;
+    };
+    StorageView view;
+    shared_ptr<MappedFile> mapping;
+
+    int64_t findInRow(int user, int item) const;
+    int64_t findInColumn(int item, int user) const;
+    void buildColumnIndex();
+    void buildRatedMasks(bool keepUserMasks = false);
+    void buildDenseView();
+    void computeUserStats();
+    void refreshUserStats(int user);
+    void refreshView();
+    void materialize();
+    bool loadText(const MappedFile& file, int numThreads);
+    bool loadBinary(const shared_ptr<MappedFile>& file, const string& filename);
+    // Índices de un archivo binario dentro de rango y ordenados, y máscaras
+    // y estadísticas guardadas coherentes con las filas
+    bool validateIndices(const UserStats* stored, const string& filename) const;
+
 public:
     UtilityMatrix();
-    bool loadFromFile(const string& filename);
+    // Las vistas apuntan a los búferes propios: se puede mover pero no copiar
+    UtilityMatrix(const UtilityMatrix&) = delete;
+    UtilityMatrix& operator=(const UtilityMatrix&) = delete;
+    UtilityMatrix(UtilityMatrix&&) = default;
+    UtilityMatrix& operator=(UtilityMatrix&&) = default;
     
+    // Detecta el formato (texto o binario) por la cabecera del archivo
+    bool loadFromFile(const string& filename, int numThreads = 0);
+    bool saveBinary(const string& filename) const;
+    // Carga la traspuesta de source (usuarios <-> items) a partir de su índice CSC
+    void transposeFrom(const UtilityMatrix& source);
+    // Retira al azar una fracción de las calificaciones (evaluación fuera de
+    // muestra) y las devuelve en heldOut; cada usuario conserva al menos una
+    void holdOut(double fraction, uint64_t seed, vector<RatingCell>& heldOut);
+    // Hash del contenido observado (dimensiones, rango y calificaciones)
+    uint64_t contentHash() const;
+
     int getNumUsers() const;
     int getNumItems() const;
+    long long getNumRatings() const;
     double getMinRating() const;
     double getMaxRating() const;
     double getRating(int user, int item) const;
     void setRating(int user, int item, double value);
+    void removeRating(int user, int item);
     bool isMissing(int user, int item) const;
     double getUserMean(int user) const;
-    void print();
-    void printPredictions();
+    const UserStats& getUserStats(int user) const;
+    SparseRow getUserRow(int user) const;
+    SparseRow getItemColumn(int item) const;
+    // Máscaras de bits por usuario (ítems calificados) y por ítem (usuarios
+    // que lo calificaron); disponibles si la matriz no es muy dispersa
+    bool hasRatedMasks() const;
+    int getMaskWords() const;
+    const uint64_t* getRatedMask(int user) const;
+    int getRaterWords() const;
+    const uint64_t* getRaterMask(int item) const;
+    bool hasDenseView() const;
+    const float* getDenseRow(int user) const;
+    void print() const;
+    // Muestra la matriz completada con las predicciones (en rojo), sin modificarla
+    void printPredictions(const PredictionSet& predictions) const;
 };
 
 #endif
@@ -1,6 +1,8 @@
 #include <iostream>
+#include <fstream>
 #include <getopt.h>
 #include "RecommenderSystem.h"
+#include "StreamingRecommender.h"
 
 using namespace std;
 
@@ -12,20 +14,104 @@ void printUsage(const char* programName) {
     cout << "                               pearson  - Correlación de Pearson" << endl;
     cout << "                               cosine   - Distancia Coseno" << endl;
     cout << "                               euclidean - Distancia Euclídea" << endl;
+    cout << "                               jaccard  - Índice de Jaccard (items calificados)" << endl;
+    cout << "  -M, --mode <modo>          Modo de filtrado:" << endl;
+    cout << "                               user     - Vecinos entre usuarios (por defecto)" << endl;
+    cout << "                               item     - Vecinos entre ítems" << endl;
+    cout << "  -e, --engine <motor>       Cálculo de similitudes:" << endl;
+    cout << "                               pairwise - Par a par (por defecto)" << endl;
+    cout << "                               blocked  - Por paneles de 8 usuarios (AVX-512/AVX2); solo" << endl;
+    cout << "                                          bloqueo en registros, sin teselas de ítems" << endl;
+    cout << "  -S, --storage <formato>    Almacenamiento de las similitudes:" << endl;
+    cout << "                               double   - Triángulo superior en double (por defecto)" << endl;
+    cout << "                               float    - Triángulo superior en float" << endl;
+    cout << "                               topk     - Solo los -l mejores vecinos (por defecto: 50)" << endl;
     cout << "  -k, --neighbors <número>   Número de vecinos a considerar" << endl;
     cout << "  -p, --prediction <tipo>    Tipo de predicción:" << endl;
     cout << "                               simple   - Predicción Simple" << endl;
     cout << "                               mean     - Diferencia con la Media" << endl;
+    cout << "  -t, --threads <número>     Hilos para el cálculo de similitudes (por defecto: todos)" << endl;
+    cout << "  -l, --neighbor-list <n>    Vecinos guardados por usuario en el índice (por defecto: 50)" << endl;
+    cout << "  -s, --similarity-cache <archivo>" << endl;
+    cout << "                             Instantánea de similitudes: se carga si corresponde a" << endl;
+    cout << "                             la métrica y a los datos; si no, se calcula y se guarda" << endl;
+    cout << "  -u, --updates <archivo>    Actualizaciones (usuario item calificación|-) a aplicar" << endl;
+    cout << "                             tras calcular las similitudes" << endl;
+    cout << "  -r, --report <formato>     Informe de predicciones en predictions.txt:" << endl;
+    cout << "                               text     - Detalle de vecinos y cálculo (por defecto)" << endl;
+    cout << "                               compact  - Una línea 'usuario item predicción' por celda" << endl;
+    cout << "                               none     - Sin informe" << endl;
+    cout << "  -n, --top <número>         Ítems recomendados por usuario (por defecto: 5)" << endl;
+    cout << "  -q, --query <archivo|->    Responder consultas 'predict <u> <i>' y 'top <u> <n>'" << endl;
+    cout << "                             leídas del archivo o de la entrada estándar (-)" << endl;
+    cout << "  -L, --lsh <tablas>         Vecinos aproximados: candidatos por LSH en <tablas> tablas" << endl;
+    cout << "                             y similitud exacta solo con ellos" << endl;
+    cout << "      --lsh-bits <número>    Bits por tabla LSH, de 1 a 64 (por defecto: según el" << endl;
+    cout << "                             número de usuarios, las tablas y -l)" << endl;
+    cout << "      --seed <número>        Semilla de las proyecciones aleatorias (por defecto: 1)" << endl;
+    cout << "      --lsh-recall           Medir el recall de los vecinos frente al cálculo exacto" << endl;
+    cout << "      --memory <MB>          Modo fuera de memoria sobre un archivo binario: lee los" << endl;
+    cout << "                             usuarios por bloques sin superar <MB> y escribe las" << endl;
+    cout << "                             predicciones compactas en predictions.txt. Las listas" << endl;
+    cout << "                             de vecinos guardan al menos k entradas (máximo de -l y -k)" << endl;
+    cout << "      --stats                Tiempos, memoria y contadores por fase en JSON" << endl;
+    cout << "                             (salida de error)" << endl;
+    cout << "      --min-overlap <n>      Ítems comunes mínimos para que dos usuarios sean vecinos" << endl;
+    cout << "      --min-similarity <s>   Similitud mínima para que dos usuarios sean vecinos" << endl;
+    cout << "      --significance <n>     Reducir la similitud de los pares con menos de <n> ítems" << endl;
+    cout << "                             comunes en proporción n_comunes / <n>" << endl;
+    cout << "      --sweep-metrics <lista>" << endl;
+    cout << "      --sweep-k <lista>" << endl;
+    cout << "      --sweep-predictions <lista>" << endl;
+    cout << "                             Barrido de configuraciones (listas separadas por comas):" << endl;
+    cout << "                             cada métrica se calcula una vez y se evalúan todas las" << endl;
+    cout << "                             combinaciones; las listas omitidas toman -m, -k y -p" << endl;
+    cout << "      --holdout <fracción>   Calificaciones retenidas para evaluar el barrido" << endl;
+    cout << "                             (por defecto: 0.1; la selección usa --seed)" << endl;
+    cout << "  -c, --convert <salida>     Convertir el archivo de -f a formato binario y salir" << endl;
     cout << "  -h, --help                 Mostrar esta ayuda" << endl;
     cout << "\nEjemplo:" << endl;
     cout << "  " << programName << " -f utility-matrix-5-10-1.txt -m pearson -k 3 -p simple" << endl;
+    cout << "  " << programName << " -f utility-matrix-5-10-1.txt --sweep-metrics pearson,cosine --sweep-k 1,3,5" << endl;
 }
 
+// Elementos de una lista separada por comas
+vector<string> splitList(const string& list) {
+    vector<string> items;
+    size_t start = 0;
+    for (;;) {
+        size_t comma = list.find(',', start);
+        items.push_back(list.substr(start, comma - start));
+        if (comma == string::npos) break;
+        start = comma + 1;
+    }
+    return items;
+}
+
+// Opciones sin forma corta
+enum LongOnlyOption {
+    OPT_LSH_BITS = 256,
+    OPT_SEED,
+    OPT_LSH_RECALL,
+    OPT_MEMORY,
+    OPT_STATS,
+    OPT_MIN_OVERLAP,
+    OPT_MIN_SIMILARITY,
+    OPT_SIGNIFICANCE,
+    OPT_SWEEP_METRICS,
+    OPT_SWEEP_K,
+    OPT_SWEEP_PREDICTIONS,
+    OPT_HOLDOUT
+};
+
 int main(int argc, char *argv[]) {
     string filename;
-    Metric metric = PEARSON;
-    int numNeighbors = 3;
-    PredictionType predictionType = SIMPLE;
+    string convertOutput;
+    string queryFile;
+    RecommenderOptions options;
+    size_t memoryBudget = 0;
+    SweepOptions sweep;
+    bool sweepMode = false;
     
     // Opciones largas
     static struct option long_options[] = {
@@ -33,6 +119,30 @@ int main(int argc, char *argv[]) {
         {"metric",     required_argument, 0, 'm'},
         {"neighbors",  required_argument, 0, 'k'},
         {"prediction", required_argument, 0, 'p'},
+        {"threads",    required_argument, 0, 't'},
+        {"neighbor-list", required_argument, 0, 'l'},
+        {"convert",    required_argument, 0, 'c'},
+        {"similarity-cache", required_argument, 0, 's'},
+        {"updates",    required_argument, 0, 'u'},
+        {"report",     required_argument, 0, 'r'},
+        {"query",      required_argument, 0, 'q'},
+        {"top",        required_argument, 0, 'n'},
+        {"mode",       required_argument, 0, 'M'},
+        {"engine",     required_argument, 0, 'e'},
+        {"storage",    required_argument, 0, 'S'},
+        {"lsh",        required_argument, 0, 'L'},
+        {"lsh-bits",   required_argument, 0, OPT_LSH_BITS},
+        {"seed",       required_argument, 0, OPT_SEED},
+        {"lsh-recall", no_argument,       0, OPT_LSH_RECALL},
+        {"memory",     required_argument, 0, OPT_MEMORY},
+        {"stats",      no_argument,       0, OPT_STATS},
+        {"min-overlap", required_argument, 0, OPT_MIN_OVERLAP},
+        {"min-similarity", required_argument, 0, OPT_MIN_SIMILARITY},
+        {"significance", required_argument, 0, OPT_SIGNIFICANCE},
+        {"sweep-metrics", required_argument, 0, OPT_SWEEP_METRICS},
+        {"sweep-k",    required_argument, 0, OPT_SWEEP_K},
+        {"sweep-predictions", required_argument, 0, OPT_SWEEP_PREDICTIONS},
+        {"holdout",    required_argument, 0, OPT_HOLDOUT},
         {"help",       no_argument,       0, 'h'},
         {0, 0, 0, 0}
     };
@@ -40,45 +150,241 @@ int main(int argc, char *argv[]) {
     int opt;
     int option_index = 0;
     
-    while ((opt = getopt_long(argc, argv, "f:m:k:p:h", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "f:m:M:e:S:k:p:t:l:c:s:u:r:q:n:L:h", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'f':
                 filename = optarg;
                 break;
                 
             case 'm':
+                if (!parseMetric(optarg, options.metric)) {
+                    return 1;
+                }
+                break;
+                
+            case 'k':
+                options.numNeighbors = atoi(optarg);
+                if (options.numNeighbors <= 0) {
+                    cerr << "Error: El número de vecinos debe ser mayor que 0" << endl;
+                    return 1;
+                }
+                break;
+                
+            case 'M':
                 {
-                    string metricStr = optarg;
-                    if (metricStr == "pearson") {
-                        metric = PEARSON;
-                    } else if (metricStr == "cosine") {
-                        metric = COSINE;
-                    } else if (metricStr == "euclidean") {
-                        metric = EUCLIDEAN;
+                    string modeStr = optarg;
+                    if (modeStr == "user") {
+                        options.mode = USER_BASED;
+                    } else if (modeStr == "item") {
+                        options.mode = ITEM_BASED;
                     } else {
-                        cerr << "Error: Métrica no válida. Use: pearson, cosine o euclidean" << endl;
+                        cerr << "Error: Modo no válido. Use: user o item" << endl;
                         return 1;
                     }
                 }
                 break;
                 
-            case 'k':
-                numNeighbors = atoi(optarg);
-                if (numNeighbors <= 0) {
-                    cerr << "Error: El número de vecinos debe ser mayor que 0" << endl;
-                    return 1;
+            case 'e':
+                {
+                    string engineStr = optarg;
+                    if (engineStr == "pairwise") {
+                        options.engine = ENGINE_PAIRWISE;
+                    } else if (engineStr == "blocked") {
+                        options.engine = ENGINE_BLOCKED;
+                    } else {
+                        cerr << "Error: Motor no válido. Use: pairwise o blocked" << endl;
+                        return 1;
+                    }
+                }
+                break;
+                
+            case 'S':
+                {
+                    string storageStr = optarg;
+                    if (storageStr == "double") {
+                        options.storage = STORAGE_DOUBLE;
+                    } else if (storageStr == "float") {
+                        options.storage = STORAGE_FLOAT;
+                    } else if (storageStr == "topk") {
+                        options.storage = STORAGE_TOPK;
+                    } else {
+                        cerr << "Error: Almacenamiento no válido. Use: double, float o topk" << endl;
+                        return 1;
+                    }
                 }
                 break;
                 
             case 'p':
+                if (!parsePrediction(optarg, options.predictionType)) {
+                    return 1;
+                }
+                break;
+                
+            case 't':
+                options.numThreads = atoi(optarg);
+                if (options.numThreads <= 0) {
+                    cerr << "Error: El número de hilos debe ser mayor que 0" << endl;
+                    return 1;
+                }
+                break;
+                
+            case 'l':
+                options.neighborListLength = atoi(optarg);
+                if (options.neighborListLength <= 0) {
+                    cerr << "Error: La longitud de la lista de vecinos debe ser mayor que 0" << endl;
+                    return 1;
+                }
+                break;
+                
+            case 'c':
+                convertOutput = optarg;
+                break;
+                
+            case 's':
+                options.similarityCache = optarg;
+                break;
+                
+            case 'u':
+                options.updatesFile = optarg;
+                break;
+                
+            case 'q':
+                queryFile = optarg;
+                break;
+                
+            case 'n':
+                options.topItems = atoi(optarg);
+                if (options.topItems <= 0) {
+                    cerr << "Error: El número de recomendaciones debe ser mayor que 0" << endl;
+                    return 1;
+                }
+                break;
+                
+            case 'r':
                 {
-                    string predStr = optarg;
-                    if (predStr == "simple") {
-                        predictionType = SIMPLE;
-                    } else if (predStr == "mean") {
-                        predictionType = MEAN_DIFF;
+                    string reportStr = optarg;
+                    if (reportStr == "text") {
+                        options.reportFormat = REPORT_TEXT;
+                    } else if (reportStr == "compact") {
+                        options.reportFormat = REPORT_COMPACT;
+                    } else if (reportStr == "none") {
+                        options.reportFormat = REPORT_NONE;
                     } else {
-                        cerr << "Error: Tipo de predicción no válido. Use: simple o mean" << endl;
+                        cerr << "Error: Formato de informe no válido. Use: text, compact o none" << endl;
+                        return 1;
+                    }
+                }
+                break;
+                
+            case 'L':
+                options.lshTables = atoi(optarg);
+                if (options.lshTables <= 0) {
+                    cerr << "Error: El número de tablas LSH debe ser mayor que 0" << endl;
+                    return 1;
+                }
+                break;
+                
+            case OPT_LSH_BITS:
+                options.lshBits = atoi(optarg);
+                if (options.lshBits < 1 || options.lshBits > 64) {
+                    cerr << "Error: Los bits por tabla LSH deben estar entre 1 y 64" << endl;
+                    return 1;
+                }
+                break;
+                
+            case OPT_SEED:
+                options.seed = strtoull(optarg, NULL, 10);
+                break;
+                
+            case OPT_LSH_RECALL:
+                options.lshRecall = true;
+                break;
+                
+            case OPT_MEMORY:
+                {
+                    long megabytes = atol(optarg);
+                    if (megabytes <= 0) {
+                        cerr << "Error: El presupuesto de memoria debe ser mayor que 0 MB" << endl;
+                        return 1;
+                    }
+                    memoryBudget = (size_t)megabytes * 1024 * 1024;
+                }
+                break;
+                
+            case OPT_STATS:
+                options.stats = true;
+                break;
+                
+            case OPT_MIN_OVERLAP:
+                options.filter.minOverlap = atoi(optarg);
+                if (options.filter.minOverlap < 1) {
+                    cerr << "Error: El mínimo de ítems comunes debe ser mayor que 0" << endl;
+                    return 1;
+                }
+                break;
+                
+            case OPT_MIN_SIMILARITY:
+                {
+                    char* end;
+                    options.filter.minSimilarity = strtod(optarg, &end);
+                    if (*end != '\0' || end == optarg) {
+                        cerr << "Error: Similitud mínima no válida '" << optarg << "'" << endl;
+                        return 1;
+                    }
+                }
+                break;
+                
+            case OPT_SIGNIFICANCE:
+                options.filter.significance = atoi(optarg);
+                if (options.filter.significance < 1) {
+                    cerr << "Error: El umbral de significancia debe ser mayor que 0" << endl;
+                    return 1;
+                }
+                break;
+                
+            case OPT_SWEEP_METRICS:
+                sweepMode = true;
+                sweep.metrics.clear();
+                for (const string& name : splitList(optarg)) {
+                    Metric metric;
+                    if (!parseMetric(name, metric)) {
+                        return 1;
+                    }
+                    sweep.metrics.push_back(metric);
+                }
+                break;
+                
+            case OPT_SWEEP_K:
+                sweepMode = true;
+                sweep.neighborCounts.clear();
+                for (const string& value : splitList(optarg)) {
+                    int k = atoi(value.c_str());
+                    if (k <= 0) {
+                        cerr << "Error: El número de vecinos debe ser mayor que 0 ('" << value << "')" << endl;
+                        return 1;
+                    }
+                    sweep.neighborCounts.push_back(k);
+                }
+                break;
+                
+            case OPT_SWEEP_PREDICTIONS:
+                sweepMode = true;
+                sweep.predictionTypes.clear();
+                for (const string& name : splitList(optarg)) {
+                    PredictionType type;
+                    if (!parsePrediction(name, type)) {
+                        return 1;
+                    }
+                    sweep.predictionTypes.push_back(type);
+                }
+                break;
+                
+            case OPT_HOLDOUT:
+                {
+                    char* end;
+                    sweep.holdout = strtod(optarg, &end);
+                    if (*end != '\0' || end == optarg || sweep.holdout <= 0.0 || sweep.holdout >= 1.0) {
+                        cerr << "Error: La fracción retenida debe estar entre 0 y 1 (exclusivo)" << endl;
                         return 1;
                     }
                 }
@@ -101,9 +407,64 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
+    // El modo aproximado no guarda la matriz de similitudes completa
+    if (options.lshTables > 0 && (!options.similarityCache.empty() || !options.updatesFile.empty())) {
+        cerr << "Error: --lsh no se puede combinar con -s ni con -u" << endl;
+        return 1;
+    }
+    if (options.storage == STORAGE_TOPK && (!options.similarityCache.empty() || !options.updatesFile.empty())) {
+        cerr << "Error: -S topk no se puede combinar con -s ni con -u" << endl;
+        return 1;
+    }
+    
+    // Modo conversión: texto -> binario
+    if (!convertOutput.empty()) {
+        UtilityMatrix matrix;
+        if (!matrix.loadFromFile(filename, options.numThreads) || !matrix.saveBinary(convertOutput)) {
+            return 1;
+        }
+        cout << "Matriz guardada en formato binario en " << convertOutput << endl;
+        return 0;
+    }
+    
+    // Modo fuera de memoria: solo filtrado por usuarios y vecinos exactos
+    if (memoryBudget > 0) {
+        if (options.mode == ITEM_BASED || options.lshTables > 0 || !options.similarityCache.empty() ||
+            !options.updatesFile.empty() || !queryFile.empty() || options.stats || sweepMode) {
+            cerr << "Error: --memory no se puede combinar con -M item, -L, -s, -u, -q, --stats ni el barrido" << endl;
+            return 1;
+        }
+        StreamingRecommender streaming(filename, options, memoryBudget);
+        return streaming.run() ? 0 : 1;
+    }
+    
+    // Barrido: las listas omitidas toman la configuración de -m, -k y -p
+    if (sweepMode) {
+        if (!options.similarityCache.empty() || !options.updatesFile.empty() || !queryFile.empty()) {
+            cerr << "Error: el barrido no se puede combinar con -s, -u ni -q" << endl;
+            return 1;
+        }
+        if (sweep.metrics.empty()) sweep.metrics.push_back(options.metric);
+        if (sweep.neighborCounts.empty()) sweep.neighborCounts.push_back(options.numNeighbors);
+        if (sweep.predictionTypes.empty()) sweep.predictionTypes.push_back(options.predictionType);
+    }
+    
     try {
-        RecommenderSystem system(filename, metric, numNeighbors, predictionType);
-        system.run();
+        RecommenderSystem system(filename, options);
+        if (sweepMode) {
+            system.runSweep(sweep);
+        } else if (queryFile.empty()) {
+            system.run();
+        } else if (queryFile == "-") {
+            system.serveQueries(cin, cout);
+        } else {
+            ifstream queries(queryFile);
+            if (!queries.is_open()) {
+                cerr << "Error: No se puede abrir el archivo " << queryFile << endl;
+                return 1;
+            }
+            system.serveQueries(queries, cout);
+        }
     } catch (const exception& e) {
         cerr << "Error: " << e.what() << endl;
         return 1;